@@ -0,0 +1,129 @@
+// Local load generator for the command server (simulation --socket <path>).
+// Every client connects on its own thread and sends commands one at a time,
+// alternating "step 1" with "planStatus <plan_id>", waiting for the
+// COMPLETED/ERROR line of each before sending the next. Reports the
+// throughput over all clients and the latency percentiles of single commands.
+//
+// usage: loadgen <socket_path> <clients> <commands_per_client> [plan_id]
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+using std::string;
+using std::vector;
+
+static long long now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connectTo(const string &socketPath) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        return -1;
+    }
+    return fd;
+}
+
+// Reads until the status line of one reply, false if the server went away
+static bool awaitReply(int fd, string &buffer) {
+    while (true) {
+        size_t end;
+        while ((end = buffer.find('\n')) != string::npos) {
+            string line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            if (line == "COMPLETED" || line == "ERROR") {
+                return true;
+            }
+        }
+        char chunk[4096];
+        ssize_t received = ::read(fd, chunk, sizeof(chunk));
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, received);
+    }
+}
+
+static bool sendLine(int fd, const string &line) {
+    size_t sent = 0;
+    while (sent < line.size()) {
+        ssize_t written = ::send(fd, line.data() + sent, line.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += written;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cout << "usage: loadgen <socket_path> <clients> <commands_per_client> [plan_id]" << std::endl;
+        return 0;
+    }
+    const string socketPath = argv[1];
+    const int clientCount = std::stoi(argv[2]);
+    const int commandCount = std::stoi(argv[3]);
+    const string planStatus = "planStatus " + string(argc > 4 ? argv[4] : "0") + "\n";
+
+    std::mutex latenciesMutex;
+    vector<long long> latencies; //Nanoseconds per command, all clients
+    int failedClients = 0;
+    auto client = [&]() {
+        vector<long long> own;
+        own.reserve(commandCount);
+        int fd = connectTo(socketPath);
+        bool ok = fd >= 0;
+        string buffer;
+        for (int i = 0; ok && i < commandCount; i++) {
+            long long start = now();
+            ok = sendLine(fd, i % 2 == 0 ? "step 1\n" : planStatus) && awaitReply(fd, buffer);
+            own.push_back(now() - start);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        std::lock_guard<std::mutex> lock(latenciesMutex);
+        latencies.insert(latencies.end(), own.begin(), own.end());
+        failedClients += ok ? 0 : 1;
+    };
+
+    long long start = now();
+    vector<std::thread> threads;
+    for (int i = 0; i < clientCount; i++) {
+        threads.push_back(std::thread(client));
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    double seconds = (now() - start) / 1e9;
+
+    if (latencies.empty()) {
+        std::cout << "No command completed" << std::endl;
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double fraction) {
+        size_t rank = static_cast<size_t>(fraction * latencies.size());
+        return latencies[std::min(rank, latencies.size() - 1)] / 1e6;
+    };
+    std::cout << "clients: " << clientCount << ", commands: " << latencies.size() << ", seconds: " << seconds << std::endl;
+    std::cout << "throughput: " << static_cast<long>(latencies.size() / seconds) << " commands/s" << std::endl;
+    std::cout << "latency ms: p50 " << percentile(0.50) << ", p99 " << percentile(0.99) << ", max " << latencies.back() / 1e6 << std::endl;
+    if (failedClients > 0) {
+        std::cout << failedClients << " clients lost their connection" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Benchmark of the settlement construction scheduler (simulation --shared-capacity).
+// Generates thousands of plans spread over a few hundred settlements, then steps
+// the simulation once with each plan's own construction limit and once with
+// the settlement capacity shared between its plans, until the same number of
+// facilities has become operational. Shared capacity admits far fewer
+// facilities per tick, so the runs are compared per facility built, per tick
+// and per plan-tick rather than by wall time over a fixed number of ticks.
+//
+// usage: schedbench [plans] [settlements] [facilities] [seed]
+#include "Simulation.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+using std::string;
+
+static long long now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Config with the given counts, settlement types and policies drawn from the seed
+static void writeConfig(const string &path, int planCount, int settlementCount, unsigned seed) {
+    std::mt19937 random(seed);
+    std::ofstream config(path);
+    for (int i = 0; i < settlementCount; i++) {
+        config << "settlement S" << i << " " << random() % 3 << "\n";
+    }
+    for (int i = 0; i < 40; i++) {
+        config << "facility F" << i << " " << i % 3 << " " << 1 + random() % 5 << " " << random() % 6 << " " << random() % 6 << " " << random() % 6 << "\n";
+    }
+    const char *policies[] = {"nve", "bal", "eco", "env"};
+    for (int i = 0; i < planCount; i++) {
+        config << "plan S" << random() % settlementCount << " " << policies[random() % 4] << "\n";
+    }
+}
+
+static long operationalFacilities(const Simulation &simulation) {
+    long total = 0;
+    for (int i = 0; i < simulation.getPlanCount(); i++) {
+        total += simulation.getPlan(i).getOperationalCount();
+    }
+    return total;
+}
+
+struct RunResult {
+    long ticks;
+    long built;
+    double seconds; //Spent in Simulation::step only
+};
+
+static RunResult run(const string &configPath, bool sharedCapacity, long facilities) {
+    Simulation simulation(configPath);
+    if (sharedCapacity) {
+        simulation.enableSharedCapacity();
+    }
+    RunResult result{0, 0, 0};
+    long long stepping = 0;
+    while (result.built < facilities) {
+        long long start = now();
+        simulation.step();
+        stepping += now() - start;
+        result.ticks++;
+        result.built = operationalFacilities(simulation);
+    }
+    result.seconds = stepping / 1e9;
+    return result;
+}
+
+static void report(const char *name, const RunResult &result, int planCount) {
+    std::cout << name << ": ticks " << result.ticks << ", facilities " << result.built
+              << ", facilities/tick " << static_cast<double>(result.built) / result.ticks
+              << ", step seconds " << result.seconds
+              << ", us/facility " << result.seconds * 1e6 / result.built
+              << ", us/tick " << result.seconds * 1e6 / result.ticks
+              << ", ns/plan-tick " << result.seconds * 1e9 / (result.ticks * planCount) << std::endl;
+}
+
+int main(int argc, char **argv) {
+    const int planCount = argc > 1 ? std::stoi(argv[1]) : 5000;
+    const int settlementCount = argc > 2 ? std::stoi(argv[2]) : 300;
+    const long facilities = argc > 3 ? std::stol(argv[3]) : 20000;
+    const unsigned seed = argc > 4 ? std::stoul(argv[4]) : 1;
+    if (planCount < 1 || settlementCount < 1 || facilities < 1) {
+        std::cout << "usage: schedbench [plans] [settlements] [facilities] [seed]" << std::endl;
+        return 0;
+    }
+    char configPath[] = "/tmp/schedbenchXXXXXX";
+    int fd = mkstemp(configPath);
+    if (fd < 0) {
+        std::cout << "Cannot create the benchmark config" << std::endl;
+        return 1;
+    }
+    ::close(fd);
+    writeConfig(configPath, planCount, settlementCount, seed);
+
+    std::cout << "plans: " << planCount << ", settlements: " << settlementCount << ", facilities to build: " << facilities << std::endl;
+    report("local", run(configPath, false, facilities), planCount);
+    report("shared", run(configPath, true, facilities), planCount);
+    std::remove(configPath);
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include "Simulation.h"
+#include "MemoryAccounting.h"
 enum class SettlementType;
 enum class FacilityCategory;
 
@@ -9,11 +10,14 @@ enum class ActionStatus{
     COMPLETED, ERROR
 };
 
-class BaseAction{
+class BaseAction : public MemoryTracked<MemorySubsystem::ACTION_LOG>{
     public:
         BaseAction();
         ActionStatus getStatus() const;
         virtual void act(Simulation& simulation)=0;
+        virtual bool resume(Simulation& simulation, int tickBudget); //Runs at most tickBudget ticks, true once finished
+        virtual void cancel();
+        virtual bool isReadOnly() const;
         virtual const string toString() const=0;
         virtual BaseAction* clone() const = 0;
         virtual ~BaseAction() = default;
@@ -33,10 +37,14 @@ class SimulateStep : public BaseAction {
     public:
         SimulateStep(const int numOfSteps);
         void act(Simulation &simulation) override;
+        bool resume(Simulation &simulation, int tickBudget) override;
+        void cancel() override;
         const string toString() const override;
         SimulateStep *clone() const override;
     private:
         const int numOfSteps;
+        int stepsLeft;
+        bool cancelled;
 };
 
 class AddPlan : public BaseAction {
@@ -84,6 +92,7 @@ class PrintPlanStatus: public BaseAction {
     public:
         PrintPlanStatus(int planId);
         void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
         PrintPlanStatus *clone() const override;
         const string toString() const override;
     private:
@@ -112,6 +121,100 @@ class PrintActionsLog : public BaseAction {
     private:
 };
 
+class PrintPlanScores : public BaseAction {
+    public:
+        PrintPlanScores();
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintPlanScores *clone() const override;
+        const string toString() const override;
+    private:
+};
+
+// Forks the simulation once per selection policy, runs each fork for numOfSteps
+// with the plan switched to that policy and reports where the plan ends up
+class EvaluatePolicies : public BaseAction {
+    public:
+        EvaluatePolicies(const int planId, const int numOfSteps);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        EvaluatePolicies *clone() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+        const int numOfSteps;
+};
+
+class PrintMemoryUsage : public BaseAction {
+    public:
+        PrintMemoryUsage();
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintMemoryUsage *clone() const override;
+        const string toString() const override;
+    private:
+};
+
+class ExportTrace : public BaseAction {
+    public:
+        ExportTrace(const string &path);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        ExportTrace *clone() const override;
+        const string toString() const override;
+    private:
+        const string path;
+};
+
+// Hardware counter totals and per plan-tick averages as JSON, see PerfCounters
+class PrintPerfCounters : public BaseAction {
+    public:
+        PrintPerfCounters(bool reset);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintPerfCounters *clone() const override;
+        const string toString() const override;
+    private:
+        const bool reset; //Start counting from zero after printing
+};
+
+class SetConstructionDuration : public BaseAction {
+    public:
+        SetConstructionDuration(FacilityCategory category, int minimum, int maximum);
+        void act(Simulation &simulation) override;
+        SetConstructionDuration *clone() const override;
+        const string toString() const override;
+    private:
+        const FacilityCategory category;
+        const int minimum;
+        const int maximum;
+};
+
+// Switches construction times to the duration model and gives every plan its own random stream
+class EnableStochastic : public BaseAction {
+    public:
+        EnableStochastic(uint64_t seed);
+        void act(Simulation &simulation) override;
+        EnableStochastic *clone() const override;
+        const string toString() const override;
+    private:
+        const uint64_t seed;
+};
+
+// Runs forks of the simulation under many seeds and reports score percentiles, see MonteCarlo
+class RunMonteCarlo : public BaseAction {
+    public:
+        RunMonteCarlo(const int runs, const int numOfSteps, uint64_t seed);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        RunMonteCarlo *clone() const override;
+        const string toString() const override;
+    private:
+        const int runs;
+        const int numOfSteps;
+        const uint64_t seed;
+};
+
 class Close : public BaseAction {
     public:
         Close();
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MemoryAccounting.h"
+using std::string;
+using std::vector;
+
+struct OperationalFacilities;
+
+// Where a plan's spilled operational facilities live in the segment file
+struct ColdSegment {
+    int64_t offset; //-1 while the plan is resident
+    int32_t runs;
+    int32_t facilityCount;
+};
+
+// Append-only segment file holding the operational facility runs of idle
+// plans. A run is stored as it is kept in memory, (catalog index, count). Written by the simulation thread only, reads
+// use pread so forks stepping on other threads may fault plans back in.
+// A sweep stages the runs of all the plans it spills and appends them with one write in flush(),
+// a staged segment can be read once it is flushed.
+// Space of segments that were faulted back in is not reclaimed.
+class ColdStore {
+    public:
+        ColdStore(const string &path);
+        ColdStore(const ColdStore &other) = delete;
+        ColdStore &operator=(const ColdStore &other) = delete;
+        ~ColdStore();
+        ColdSegment stage(const vector<OperationalFacilities, TrackingAllocator<OperationalFacilities, MemorySubsystem::PLAN>> &runs);
+        void flush();
+        void read(const ColdSegment &segment, vector<OperationalFacilities, TrackingAllocator<OperationalFacilities, MemorySubsystem::PLAN>> &runs) const;
+        int64_t getSize() const;
+
+    private:
+        int fd;
+        int64_t size; //Bytes written to the file, staged records go after them
+        vector<int32_t> staged; //Records waiting for flush(), kept to reuse its capacity
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+using std::shared_ptr;
+using std::string;
+
+class ClientSession;
+
+// A text command waiting to be executed by the simulation thread
+struct Command {
+    Command(const string &line, const shared_ptr<ClientSession> &client);
+    const string line;
+    const shared_ptr<ClientSession> client;
+    std::atomic<Command*> next;
+};
+
+// Multi-producer single-consumer lock-free queue (intrusive, Vyukov style).
+// Any thread may push, only the simulation thread may pop.
+class CommandQueue {
+    public:
+        CommandQueue();
+        CommandQueue(const CommandQueue &other) = delete;
+        CommandQueue &operator=(const CommandQueue &other) = delete;
+        ~CommandQueue();
+        void push(Command *command);
+        Command *pop(); //Returns nullptr when empty, the caller owns the returned command
+        bool isEmpty() const;
+
+    private:
+        void link(Command *command);
+        Command stub;
+        std::atomic<Command*> head; //Producers side
+        Command *tail; //Consumer side
+        std::atomic<long> size;
+};
@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CommandQueue.h"
+using std::shared_ptr;
+using std::string;
+using std::vector;
+using std::weak_ptr;
+
+class Simulation;
+class BaseAction;
+
+// One connected client, replies are written by the simulation thread
+class ClientSession {
+    public:
+        ClientSession(int fd);
+        ClientSession(const ClientSession &other) = delete;
+        ClientSession &operator=(const ClientSession &other) = delete;
+        ~ClientSession();
+        bool readLine(string &line);
+        void reply(const string &text);
+        void shutdown();
+
+    private:
+        const int fd;
+        string buffer;
+};
+
+// An action waiting for the in-flight one to finish
+struct PendingAction {
+    BaseAction *action;
+    shared_ptr<ClientSession> client;
+};
+
+// Reader thread of one client, joined by the acceptor once it has finished
+struct ClientConnection {
+    std::thread thread;
+    weak_ptr<ClientSession> session;
+    bool finished; //Guarded by clientsMutex
+};
+
+// Unix domain socket front end: every client sends the same text commands
+// as the interactive console, one per line. Commands from all clients go
+// through a lock-free queue into the thread that owns the simulation, which
+// drains them in batches and replies with the action output followed by
+// a COMPLETED/ERROR status line.
+// Long actions (SimulateStep) run ticksPerSlice ticks at a time; read-only
+// actions of other clients are served between slices, other actions wait
+// for it to finish and "cancel" stops it at the next tick boundary. Each
+// client gets its replies in the order it sent the commands.
+class CommandServer {
+    public:
+        CommandServer(Simulation &simulation, const string &socketPath);
+        CommandServer(const CommandServer &other) = delete;
+        CommandServer &operator=(const CommandServer &other) = delete;
+        ~CommandServer();
+        void run(); //Serves commands on the calling thread until a "close" command arrives
+        void stop();
+
+    private:
+        void acceptClients();
+        void reapClients();
+        void serveClient(shared_ptr<ClientSession> client, std::list<ClientConnection>::iterator connection);
+        bool hasPending(const shared_ptr<ClientSession> &client) const;
+        void submit(Command *command);
+        void waitForCommands();
+        int drain();
+        void execute(const Command &command);
+        void start(BaseAction *action, const shared_ptr<ClientSession> &client);
+        void advance();
+        void finish(BaseAction *action, const shared_ptr<ClientSession> &client, const string &output);
+        void abandonPending();
+
+        static const int maxBatch = 256;
+        static const int ticksPerSlice = 1000;
+        Simulation &simulation;
+        const string socketPath;
+        int listenFd;
+        CommandQueue queue;
+        BaseAction *inFlight;
+        shared_ptr<ClientSession> inFlightClient;
+        string inFlightOutput;
+        std::deque<PendingAction> deferred;
+        std::atomic<bool> running;
+        std::atomic<bool> waiting;
+        std::mutex wakeMutex;
+        std::condition_variable wakeUp;
+        std::thread acceptor;
+        std::mutex clientsMutex;
+        std::list<ClientConnection> clients;
+};
@@ -0,0 +1,177 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include "Facility.h"
+#include "Settlement.h"
+#include "SelectionPolicy.h"
+
+// Config lines baked into the binary by scripts/embed_config.awk
+struct CatalogEntry {
+    const char *name;
+    FacilityCategory category;
+    int price;
+    int lifeQualityScore;
+    int economyScore;
+    int environmentScore;
+};
+
+struct SettlementEntry {
+    const char *name;
+    SettlementType type;
+};
+
+struct PlanEntry {
+    const char *settlementName;
+    const char *selectionPolicy;
+};
+
+struct DurationEntry {
+    FacilityCategory category;
+    int minimum;
+    int maximum;
+};
+
+template <size_t size>
+constexpr int countCategory(const std::array<CatalogEntry, size> &catalog, FacilityCategory category) {
+    int count = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (catalog[i].category == category) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// Indices of the category's entries, in catalog order
+template <const auto &catalog, FacilityCategory category>
+constexpr auto categoryPartition() {
+    std::array<int, countCategory(catalog, category)> indices{};
+    int next = 0;
+    for (size_t i = 0; i < catalog.size(); i++) {
+        if (catalog[i].category == category) {
+            indices[next++] = i;
+        }
+    }
+    return indices;
+}
+
+constexpr int balanceDistance(const CatalogEntry &entry, int lifeQualityScore, int economyScore, int environmentScore) {
+    int lifeScore = lifeQualityScore + entry.lifeQualityScore;
+    int econScore = economyScore + entry.economyScore;
+    int envScore = environmentScore + entry.environmentScore;
+    return std::max({lifeScore, econScore, envScore}) - std::min({lifeScore, econScore, envScore});
+}
+
+// Entry indices ordered by how balanced each facility is on its own (stable, so ties keep catalog order)
+template <const auto &catalog>
+constexpr auto balanceOrder() {
+    std::array<int, catalog.size()> order{};
+    for (size_t i = 0; i < catalog.size(); i++) {
+        order[i] = i;
+    }
+    for (size_t i = 1; i < catalog.size(); i++) {
+        int index = order[i];
+        size_t j = i;
+        while (j > 0 && balanceDistance(catalog[order[j - 1]], 0, 0, 0) > balanceDistance(catalog[index], 0, 0, 0)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = index;
+    }
+    return order;
+}
+
+// EconomySelection/SustainabilitySelection over a compile-time catalog: walks
+// the precomputed partition instead of scanning. Once AddFacility grows the
+// runtime catalog past the compiled one it falls back to a regular scan.
+template <const auto &catalog, FacilityCategory category>
+class CompiledCategorySelection: public SelectionPolicy {
+    public:
+        CompiledCategorySelection() : lastSelectedIndex(-1) {}
+
+        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override {
+            static constexpr auto partition = categoryPartition<catalog, category>();
+            if (facilitiesOptions.size() == catalog.size() && partition.size() > 0) {
+                size_t next = 0;
+                while (next < partition.size() && partition[next] <= lastSelectedIndex) {
+                    next++;
+                }
+                lastSelectedIndex = partition[next % partition.size()];
+                return facilitiesOptions[lastSelectedIndex];
+            }
+            int size = facilitiesOptions.size();
+            for (int step = 1; step <= size; step++) {
+                int i = (lastSelectedIndex + step) % size;
+                if (facilitiesOptions[i].getCategory() == category) {
+                    lastSelectedIndex = i;
+                    return facilitiesOptions[i];
+                }
+            }
+            return facilitiesOptions[(lastSelectedIndex + 1) % size];
+        }
+
+        const string toString() const override {
+            return category == FacilityCategory::ECONOMY ? "Economy Selection Policy" : "Sustainability Selection Policy";
+        }
+
+        CompiledCategorySelection *clone() const override {
+            return new CompiledCategorySelection(*this);
+        }
+
+        // Restored as the generic policy, which walks the catalog the same way
+        PolicyState saveState() const override {
+            PolicyKind kind = category == FacilityCategory::ECONOMY ? PolicyKind::ECONOMY : PolicyKind::SUSTAINABILITY;
+            return PolicyState{kind, {lastSelectedIndex, 0, 0}, 0};
+        }
+
+    private:
+        int lastSelectedIndex;
+};
+
+// BalancedSelection over a compile-time catalog. From a zero score the pick is
+// known at compile time; otherwise the scan runs over the constexpr entries.
+template <const auto &catalog>
+class CompiledBalancedSelection: public SelectionPolicy {
+    public:
+        CompiledBalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore)
+            : LifeQualityScore(LifeQualityScore), EconomyScore(EconomyScore), EnvironmentScore(EnvironmentScore) {}
+
+        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override {
+            static constexpr auto order = balanceOrder<catalog>();
+            if (facilitiesOptions.size() != catalog.size() || catalog.size() == 0) {
+                BalancedSelection generic(LifeQualityScore, EconomyScore, EnvironmentScore);
+                return generic.selectFacility(facilitiesOptions);
+            }
+            if (LifeQualityScore == 0 && EconomyScore == 0 && EnvironmentScore == 0) {
+                return facilitiesOptions[order[0]];
+            }
+            size_t minIndex = 0;
+            int minDistance = balanceDistance(catalog[0], LifeQualityScore, EconomyScore, EnvironmentScore);
+            for (size_t i = 1; i < catalog.size(); i++) {
+                int distance = balanceDistance(catalog[i], LifeQualityScore, EconomyScore, EnvironmentScore);
+                if (distance < minDistance) {
+                    minDistance = distance;
+                    minIndex = i;
+                }
+            }
+            return facilitiesOptions[minIndex];
+        }
+
+        const string toString() const override {
+            return "Balanced Selection Policy";
+        }
+
+        CompiledBalancedSelection *clone() const override {
+            return new CompiledBalancedSelection(*this);
+        }
+
+        PolicyState saveState() const override {
+            return PolicyState{PolicyKind::BALANCED, {LifeQualityScore, EconomyScore, EnvironmentScore}, 0};
+        }
+
+    private:
+        int LifeQualityScore;
+        int EconomyScore;
+        int EnvironmentScore;
+};
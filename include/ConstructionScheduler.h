@@ -0,0 +1,40 @@
+#pragma once
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Settlement.h"
+using std::vector;
+
+// Shares each settlement's construction capacity (VILLAGE 1, CITY 2,
+// METROPOLIS 3 at a time) between all plans building there. A plan with
+// room of its own queues at its settlement, ordered by score deficit: the
+// plan with the lowest total score at the time it queued is admitted first,
+// ties by plan ID. Settlements that have both free capacity and a queue are
+// kept in a ready list, so a tick only visits settlements that can admit.
+class ConstructionScheduler {
+    public:
+        static int getCapacity(SettlementType type);
+        void addSettlement(const Settlement &settlement);
+        void enqueue(int planId, const Settlement &settlement, int totalScore);
+        bool isQueued(int planId) const;
+        void build(const Settlement &settlement, int count); //Facilities started outside admit()
+        void release(const Settlement &settlement, int count); //Facilities that became operational
+        void admit(vector<int> &planIds); //Plans that may pick a facility this tick
+
+    private:
+        typedef std::pair<int, int> Entry; //(total score, plan ID)
+        struct SettlementQueue {
+            int capacity;
+            int inUse;
+            bool isReady;
+            std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> waiting;
+        };
+        SettlementQueue &queueOf(const Settlement &settlement);
+        void updateReady(int index);
+        std::unordered_map<const Settlement*, int> indices;
+        vector<SettlementQueue> queues;
+        vector<int> ready;
+        vector<bool> queued; //By plan ID
+};
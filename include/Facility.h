@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "MemoryAccounting.h"
 using std::string;
 using std::vector;
 
@@ -37,11 +38,12 @@ class FacilityType {
 
 
 
-class Facility: public FacilityType {
+class Facility: public FacilityType, public MemoryTracked<MemorySubsystem::FACILITY> {
 
     public:
         Facility(const string &name, const string &settlementName, const FacilityCategory category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
         Facility(const FacilityType &type, const string &settlementName);
+        Facility(const FacilityType &type, const string &settlementName, FacilityStatus status, int timeLeft);
         const string &getSettlementName() const;
         const int getTimeLeft() const;
         FacilityStatus step();
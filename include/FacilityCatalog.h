@@ -0,0 +1,41 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "Facility.h"
+#include "MemoryAccounting.h"
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+// Immutable, versioned list of the facility types plans can choose from.
+// Readers pin the current version and keep using it for the whole tick,
+// writers publish a new version instead of mutating the one being read.
+// A version is reclaimed once the last reader holding it lets go.
+class FacilityCatalog {
+    public:
+        class Snapshot : public MemoryTracked<MemorySubsystem::REGISTRY> {
+            public:
+                const vector<FacilityType> &getOptions() const;
+                long getVersion() const;
+                ~Snapshot();
+
+            private:
+                friend class FacilityCatalog;
+                Snapshot(vector<FacilityType> options, long version);
+                const vector<FacilityType> options;
+                const long version;
+        };
+
+        FacilityCatalog();
+        FacilityCatalog(const FacilityCatalog &other); //Shares the current version
+        FacilityCatalog &operator=(const FacilityCatalog &other) = delete;
+        shared_ptr<const Snapshot> pin() const;
+        bool isFacilityExists(const string &facilityName) const;
+        bool addFacility(const FacilityType &facility);
+        bool addFacilities(const vector<FacilityType> &facilities);
+        long getVersion() const;
+
+    private:
+        shared_ptr<const Snapshot> current; //Only accessed through std::atomic_load/atomic_store
+};
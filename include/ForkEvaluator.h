@@ -0,0 +1,21 @@
+#pragma once
+#include <functional>
+#include <vector>
+using std::vector;
+
+class Simulation;
+
+// Scores of every plan at the end of one what-if run, indexed by plan ID
+struct ForkOutcome {
+    vector<int> lifeQualityScores;
+    vector<int> economyScores;
+    vector<int> environmentScores;
+};
+
+// Runs alternatives side by side: each one gets its own fork of the base
+// simulation, applies its change and is stepped for the same number of ticks.
+// Forks are taken up front on the calling thread, then stepped in parallel.
+class ForkEvaluator {
+    public:
+        static vector<ForkOutcome> run(const Simulation &base, const vector<std::function<void(Simulation&)>> &alternatives, int ticks, int threadCount);
+};
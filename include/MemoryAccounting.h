@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <string>
+using std::string;
+
+enum class MemorySubsystem {
+    PLAN,
+    FACILITY,
+    SELECTION_POLICY,
+    ACTION_LOG,
+    REGISTRY,
+};
+
+// Process wide live/peak bytes and allocation counts, tagged by subsystem
+class MemoryAccounting {
+    public:
+        static const int subsystemCount = 5;
+        static void recordAllocation(MemorySubsystem subsystem, size_t bytes);
+        static void recordDeallocation(MemorySubsystem subsystem, size_t bytes);
+        static long getLiveBytes(MemorySubsystem subsystem);
+        static long getPeakBytes(MemorySubsystem subsystem);
+        static long getAllocations(MemorySubsystem subsystem);
+        static const string getName(MemorySubsystem subsystem);
+        static const string toString(long ticks);
+        static const string toJson();
+
+    private:
+        struct Counters {
+            std::atomic<long> liveBytes;
+            std::atomic<long> peakBytes;
+            std::atomic<long> allocations;
+        };
+        static Counters counters[subsystemCount];
+};
+
+// Inherit to have every heap allocation of the class counted under a subsystem
+template <MemorySubsystem subsystem>
+class MemoryTracked {
+    public:
+        static void *operator new(size_t size) {
+            void *memory = ::operator new(size);
+            MemoryAccounting::recordAllocation(subsystem, size);
+            return memory;
+        }
+        static void operator delete(void *memory, size_t size) {
+            MemoryAccounting::recordDeallocation(subsystem, size);
+            ::operator delete(memory);
+        }
+};
+
+// Allocator for containers whose buffers belong to a subsystem
+template <typename T, MemorySubsystem subsystem>
+class TrackingAllocator {
+    public:
+        typedef T value_type;
+        template <typename U>
+        struct rebind {
+            typedef TrackingAllocator<U, subsystem> other;
+        };
+
+        TrackingAllocator() = default;
+        template <typename U>
+        TrackingAllocator(const TrackingAllocator<U, subsystem> &) {}
+
+        T *allocate(size_t count) {
+            T *memory = static_cast<T*>(::operator new(count * sizeof(T)));
+            MemoryAccounting::recordAllocation(subsystem, count * sizeof(T));
+            return memory;
+        }
+        void deallocate(T *memory, size_t count) {
+            MemoryAccounting::recordDeallocation(subsystem, count * sizeof(T));
+            ::operator delete(memory);
+        }
+
+        template <typename U>
+        bool operator==(const TrackingAllocator<U, subsystem> &) const { return true; }
+        template <typename U>
+        bool operator!=(const TrackingAllocator<U, subsystem> &) const { return false; }
+};
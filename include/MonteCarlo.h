@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+using std::vector;
+
+class Simulation;
+
+// Spread of one score over all runs, percentiles are nearest-rank
+struct ScoreDistribution {
+    double mean;
+    int p5, p50, p95;
+};
+
+struct PlanDistribution {
+    int planId;
+    ScoreDistribution lifeQuality, economy, environment;
+};
+
+struct MonteCarloReport {
+    vector<PlanDistribution> plans; //Plans this process steps, by plan ID
+    double planTicksPerSecond;
+};
+
+// Runs the simulation forward many times in stochastic mode. Run i is a fork
+// seeded with RandomStream::mix(seed, i), so the report is the same for any
+// thread count. Forks are taken in batches to bound memory on long runs.
+class MonteCarlo {
+    public:
+        static MonteCarloReport run(const Simulation &base, int runs, int ticks, uint64_t seed, int threadCount);
+        static ScoreDistribution summarize(vector<int> &scores);
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+using std::string;
+
+enum class PerfRegion {
+    TICK,      //Simulation::step, per plan stepped
+    SELECTION, //Selection stage of Simulation::step, per plan that picked
+};
+
+// Hardware counters (cycles, instructions, L1D/LLC read misses, branch misses)
+// read through perf_event_open as one group per thread, opened on first use.
+// Scopes add their deltas to per-region totals which are reported per
+// plan-tick. Events the CPU or kernel refuses are reported as null; if none
+// can be opened the report says why and scopes cost one relaxed load.
+// Build with -DSIMULATION_NO_PERF_COUNTERS to compile the scopes out.
+class PerfCounters {
+    public:
+        static const int eventCount = 5;
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+        static void enable();
+        static void disable();
+        static void reset();
+        static bool read(uint64_t values[eventCount]); //Counts of the calling thread so far, false if unavailable
+        static void add(PerfRegion region, const uint64_t before[eventCount], const uint64_t after[eventCount], long planTicks);
+        static const string toJson();
+
+    private:
+        static std::atomic<bool> enabled;
+};
+
+class PerfScope {
+    public:
+#ifdef SIMULATION_NO_PERF_COUNTERS
+        PerfScope(PerfRegion, long = 1) {}
+        void setPlanTicks(long) {}
+#else
+        PerfScope(PerfRegion region, long planTicks = 1) : region(region), planTicks(planTicks), active(false) {
+            if (PerfCounters::isEnabled()) {
+                active = PerfCounters::read(before);
+            }
+        }
+        PerfScope(const PerfScope &other) = delete;
+        PerfScope &operator=(const PerfScope &other) = delete;
+        ~PerfScope() {
+            uint64_t after[PerfCounters::eventCount];
+            if (active && PerfCounters::read(after)) {
+                PerfCounters::add(region, before, after, planTicks);
+            }
+        }
+        void setPlanTicks(long planTicks) {
+            this->planTicks = planTicks;
+        }
+
+    private:
+        const PerfRegion region;
+        long planTicks;
+        bool active;
+        uint64_t before[PerfCounters::eventCount];
+#endif
+};
@@ -1,8 +1,12 @@
 #pragma once
 #include <vector>
 #include "Facility.h"
+#include "FacilityCatalog.h"
 #include "Settlement.h"
 #include "SelectionPolicy.h"
+#include "Stochastic.h"
+#include "ColdStore.h"
+#include <memory>
 using std::vector;
 
 enum class PlanStatus {
@@ -10,26 +14,103 @@ enum class PlanStatus {
     BUSY,
 };
 
+class Plan;
+
+// Operational facilities never change again, so a plan only keeps a count per
+// type. Types are referred to by catalog index, which stays valid since the
+// catalog only ever grows.
+struct OperationalFacilities {
+    OperationalFacilities(int typeIndex, int count);
+    int typeIndex;
+    int count;
+};
+
+using OperationalRuns = vector<OperationalFacilities, TrackingAllocator<OperationalFacilities, MemorySubsystem::PLAN>>;
+
+// A facility being built and the catalog index of its type
+struct FacilityUnderConstruction {
+    Facility *facility;
+    int typeIndex;
+};
+
+// Read-only view over all of a plan's facilities: the ones under construction
+// first, then one Facility per operational unit, materialized on demand
+class PlanFacilities {
+    public:
+        class Iterator {
+            public:
+                Iterator(const Plan &plan, const vector<FacilityType> &facilitiesOptions, const OperationalRuns &operational, int constructionIndex, int operationalIndex, int unit);
+                Facility operator*() const;
+                Iterator &operator++();
+                bool operator==(const Iterator &other) const;
+                bool operator!=(const Iterator &other) const;
+
+            private:
+                const Plan &plan;
+                const vector<FacilityType> &facilitiesOptions;
+                const OperationalRuns &operational;
+                int constructionIndex;
+                int operationalIndex;
+                int unit;
+        };
+
+        PlanFacilities(const Plan &plan, const vector<FacilityType> &facilitiesOptions, const std::shared_ptr<const OperationalRuns> &operational);
+        Iterator begin() const;
+        Iterator end() const;
+        int size() const;
+
+    private:
+        const Plan &plan;
+        const vector<FacilityType> &facilitiesOptions; //The catalog the plan's type indices refer to
+        std::shared_ptr<const OperationalRuns> operational; //All the plan's runs, read back from the cold store if it is spilled
+};
+
 class Plan {
     public:
-        Plan(const int planId, const Settlement *settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions);
+        Plan(const int planId, const Settlement *settlement, SelectionPolicy *selectionPolicy);
+        Plan(const Plan &other);
+        Plan &operator=(const Plan &other) = delete;
+        ~Plan();
         const int getlifeQualityScore() const;
         const int getEconomyScore() const;
         const int getEnvironmentScore() const;
+        const Settlement &getSettlement() const;
+        PlanStatus getStatus() const;
+        bool isIdle() const;
+        int getUnderConstructionCount() const;
+        int getOperationalCount() const;
         void setSelectionPolicy(SelectionPolicy *selectionPolicy);
-        void step();
-        void printStatus();
-        const vector<Facility*> &getFacilities() const;
-        void addFacility(Facility* facility);
+        void seed(uint64_t seed);
+        void setStochastic(const std::shared_ptr<const StochasticModel> &model, uint64_t seed);
+        bool canSpill() const;
+        void spill(ColdStore &store);
+        bool isSpilled() const;
+        void faultIn();
+        bool needsSelection() const;
+        void select(const vector<FacilityType> &facilitiesOptions);
+        void commitSelection(const vector<FacilityType> &facilitiesOptions, int typeIndex);
+        int advance();
+        SelectionPolicy &getSelectionPolicy();
+        void printStatus(const vector<FacilityType> &facilitiesOptions) const;
+        PlanFacilities getFacilities(const vector<FacilityType> &facilitiesOptions) const;
+        void addFacility(Facility* facility, int typeIndex);
         const string toString() const;
 
     private:
+        friend class PlanFacilities;
+        friend class SimulationImage;
+        void addOperational(int typeIndex);
+        OperationalRuns &ownOperational();
+        std::shared_ptr<OperationalRuns> readOperational() const;
         int plan_id;
         const Settlement &settlement;
         SelectionPolicy *selectionPolicy; //What happens if we change this to a reference?
         PlanStatus status;
-        vector<Facility*> facilities;
-        vector<Facility*> underConstruction;
-        const vector<FacilityType> &facilityOptions;
+        vector<FacilityUnderConstruction, TrackingAllocator<FacilityUnderConstruction, MemorySubsystem::PLAN>> underConstruction;
+        std::shared_ptr<OperationalRuns> operational; //Shared with copies of the plan until one adds a run. Only the ones added since the spill while spilled
         int life_quality_score, economy_score, environment_score;
+        std::shared_ptr<const StochasticModel> stochastic; //nullptr for the deterministic 10 step construction
+        RandomStream random;
+        ColdSegment coldSegment;
+        const ColdStore *coldStore; //Holds the spilled runs, nullptr if never spilled
 };
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+#include "Plan.h"
+using std::string;
+using std::vector;
+
+class Simulation;
+
+// What other threads may read about a plan, copied out at the end of a tick
+struct PlanSummary {
+    int planId;
+    PlanStatus status;
+    int lifeQualityScore, economyScore, environmentScore;
+    int underConstructionCount, operationalCount;
+    string settlementName;
+};
+
+struct PublishedView {
+    long tick;
+    vector<PlanSummary> plans; //Plans this process steps
+};
+
+// Two views of the plans: readers use the front one while the simulation
+// writes the next tick into the back one and then flips. Readers never block
+// the writer: if a reader still holds the back view, that tick is simply not
+// published and readers keep seeing the previous one (check PublishedView::tick).
+class PublishedState {
+    public:
+        // Keeps a view from being rewritten while it is read
+        class Reader {
+            public:
+                Reader(const PublishedState &state);
+                Reader(const Reader &other) = delete;
+                Reader &operator=(const Reader &other) = delete;
+                ~Reader();
+                const PublishedView &view() const;
+
+            private:
+                const PublishedState &state;
+                int index;
+        };
+
+        PublishedState();
+        PublishedState(const PublishedState &other) = delete;
+        PublishedState &operator=(const PublishedState &other) = delete;
+        Reader read() const;
+        bool publish(const Simulation &simulation); //Only called by the simulation thread
+
+    private:
+        PublishedView views[2];
+        mutable std::atomic<int> readers[2];
+        std::atomic<int> front;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+// Rows of the score time series, stored column by column
+struct ScoreBlock {
+    void clear();
+    size_t size() const;
+    vector<int64_t> ticks;
+    vector<int32_t> planIds;
+    vector<int32_t> lifeQualityScores;
+    vector<int32_t> economyScores;
+    vector<int32_t> environmentScores;
+};
+
+// Streams every plan's scores, tick by tick, into a columnar binary file.
+// Only plans whose scores changed since their last row are recorded.
+// The simulation thread fills one block while a background thread writes
+// the other, so the tick loop only waits when the disk falls a block behind.
+//
+// File layout, repeated per block (native endianness):
+//   uint32 magic, uint32 rows, int64 ticks[rows], int32 planIds[rows],
+//   int32 lifeQuality[rows], int32 economy[rows], int32 environment[rows]
+class ScoreRecorder {
+    public:
+        ScoreRecorder(const string &path);
+        ScoreRecorder(const ScoreRecorder &other) = delete;
+        ScoreRecorder &operator=(const ScoreRecorder &other) = delete;
+        ~ScoreRecorder();
+        void record(long tick, int planId, int lifeQualityScore, int economyScore, int environmentScore);
+        static bool convertToCsv(const string &binaryPath, const string &csvPath);
+
+    private:
+        void swapBlocks();
+        void writeBlocks();
+
+        static const uint32_t magic = 0x53434f52;
+        static const size_t blockRows = 1 << 16;
+        std::ofstream output;
+        vector<int32_t> lastScores; //Three per plan, last recorded values
+        vector<bool> recorded; //Per plan, whether its first row was written, so a plan starting at 0 is not skipped
+        ScoreBlock blocks[2];
+        ScoreBlock *filling;
+        ScoreBlock *writing; //nullptr while the writer is idle
+        bool closing;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::thread writer;
+};
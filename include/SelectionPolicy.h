@@ -1,22 +1,44 @@
 #pragma once
 #include <vector>
 #include "Facility.h"
+#include "MemoryAccounting.h"
+#include "Stochastic.h"
 using std::vector;
 
-class SelectionPolicy {
+enum class PolicyKind {
+    NAIVE,
+    BALANCED,
+    ECONOMY,
+    SUSTAINABILITY,
+    RANDOM,
+};
+
+// Plain-data form of a policy, for keeping it outside the process
+struct PolicyState {
+    PolicyKind kind;
+    int32_t values[3]; //Cursor, or the scores of a balanced policy
+    uint64_t random;
+};
+
+class SelectionPolicy : public MemoryTracked<MemorySubsystem::SELECTION_POLICY> {
     public:
         virtual const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) = 0;
         virtual const string toString() const = 0;
         virtual SelectionPolicy* clone() const = 0;
+        virtual void reseed(uint64_t seed); //Policies that draw random numbers take them from their plan's stream
+        virtual PolicyState saveState() const = 0;
+        static SelectionPolicy *restoreState(const PolicyState &state);
         virtual ~SelectionPolicy() = default;
 };
 
 class NaiveSelection: public SelectionPolicy {
     public:
         NaiveSelection();
+        NaiveSelection(int lastSelectedIndex);
         const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
         const string toString() const override;
         NaiveSelection *clone() const override;
+        PolicyState saveState() const override;
         ~NaiveSelection() override = default;
     private:
         int lastSelectedIndex;
@@ -28,7 +50,10 @@ class BalancedSelection: public SelectionPolicy {
         const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
         const string toString() const override;
         BalancedSelection *clone() const override;
+        PolicyState saveState() const override;
         ~BalancedSelection() override = default;
+        // Picks for many policies at once, same results as calling selectFacility on each
+        static void selectBatch(const vector<BalancedSelection*> &policies, const vector<FacilityType> &facilitiesOptions, vector<int> &selected);
     private:
         int LifeQualityScore;
         int EconomyScore;
@@ -38,9 +63,11 @@ class BalancedSelection: public SelectionPolicy {
 class EconomySelection: public SelectionPolicy {
     public:
         EconomySelection();
+        EconomySelection(int lastSelectedIndex);
         const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
         const string toString() const override;
         EconomySelection *clone() const override;
+        PolicyState saveState() const override;
         ~EconomySelection() override = default;
     private:
         int lastSelectedIndex;
@@ -50,10 +77,25 @@ class EconomySelection: public SelectionPolicy {
 class SustainabilitySelection: public SelectionPolicy {
     public:
         SustainabilitySelection();
+        SustainabilitySelection(int lastSelectedIndex);
         const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
         const string toString() const override;
         SustainabilitySelection *clone() const override;
+        PolicyState saveState() const override;
         ~SustainabilitySelection() override = default;
     private:
         int lastSelectedIndex;
+};
+
+class RandomSelection: public SelectionPolicy {
+    public:
+        RandomSelection();
+        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const string toString() const override;
+        RandomSelection *clone() const override;
+        void reseed(uint64_t seed) override;
+        PolicyState saveState() const override;
+        ~RandomSelection() override = default;
+    private:
+        RandomStream random;
 };
\ No newline at end of file
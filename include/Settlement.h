@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <vector>
+#include "MemoryAccounting.h"
 using std::string;
 using std::vector;
 
@@ -12,7 +13,7 @@ enum class SettlementType {
     METROPOLIS,
 };
 
-class Settlement {
+class Settlement : public MemoryTracked<MemorySubsystem::REGISTRY> {
     public:
         Settlement(const string &name, SettlementType type);
         const string &getName() const;
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+class Simulation;
+
+// Files the workers write to, each appends its shard index to the path.
+// Empty paths leave the feature off.
+struct ShardFiles {
+    string recordPath; //Score time series of the shard's plans, see ScoreRecorder
+    string coldStorePath; //Segment file for the shard's idle plans, see ColdStore
+    int coldAfterTicks;
+};
+
+// A worker process stepping one shard of the plans
+struct ShardWorker {
+    int pid;
+    int commands; //Coordinator writes command lines here
+    FILE *replies; //Worker answers with the action output and a COMPLETED/ERROR line
+};
+
+// Splits one simulation across shardCount worker processes on this machine.
+// Settlements are partitioned by name hash; every worker is forked from the
+// loaded simulation and receives every command, so registries and plan IDs
+// stay identical everywhere, but it only steps the plans of its own
+// settlements. Plans only depend on their settlement and the catalog, so
+// the scores match a single-process run. Replies listing plans (scores,
+// montecarlo) are merged by plan ID.
+class ShardCoordinator {
+    public:
+        ShardCoordinator(Simulation &simulation, int shardCount, const ShardFiles &files);
+        ShardCoordinator(const ShardCoordinator &other) = delete;
+        ShardCoordinator &operator=(const ShardCoordinator &other) = delete;
+        ~ShardCoordinator();
+        string execute(const string &line); //Returns the combined reply, ending with COMPLETED/ERROR
+        void close();
+
+    private:
+        void serveShard(int shardIndex, int commands, int replies, const ShardFiles &files);
+        void send(ShardWorker &worker, const string &line);
+        string receive(ShardWorker &worker);
+        string broadcast(const string &line);
+        string sendToOwner(int planId, const string &line);
+        string aggregateScores();
+        string aggregateMonteCarlo(const string &line);
+
+        Simulation &simulation; //Registry copy used to validate and route commands, never stepped
+        const int shardCount;
+        vector<ShardWorker> workers;
+};
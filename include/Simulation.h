@@ -1,35 +1,98 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
 #include "Facility.h"
+#include "FacilityCatalog.h"
 #include "Plan.h"
 #include "Settlement.h"
+#include "MemoryAccounting.h"
+#include "ScoreRecorder.h"
+#include "Stochastic.h"
+#include "PublishedState.h"
+#include "ColdStore.h"
+#include "SimulationImage.h"
+#include "ConstructionScheduler.h"
 using std::string;
 using std::vector;
 
 class BaseAction;
 class SelectionPolicy;
+class BalancedSelection;
+
+// Selects the constructor that loads the config compiled in at build time
+struct EmbeddedConfig {};
 
 class Simulation {
     public:
         Simulation(const string &configFilePath);
+        Simulation(EmbeddedConfig embedded);
+        Simulation &operator=(const Simulation &other) = delete;
+        ~Simulation();
+        std::unique_ptr<Simulation> fork() const;
+        static std::unique_ptr<Simulation> openImage(const string &imagePath, int everyTicks);
+        void attachImage(const string &imagePath, int everyTicks);
+        void checkpoint();
         void start();
         void addPlan(const Settlement *settlement, SelectionPolicy *selectionPolicy);
         void addAction(BaseAction *action);
         bool addSettlement(Settlement *settlement);
         bool addFacility(FacilityType facility);
+        bool addFacilities(const vector<FacilityType> &facilities);
         bool isSettlementExists(const string &settlementName);
         Settlement *getSettlement(const string &settlementName);
+        const FacilityCatalog &getFacilityCatalog() const;
         Plan &getPlan(const int planID);
+        const Plan &getPlan(const int planID) const;
         void step();
         void close();
         void open();
+        long getTick() const;
+        void startRecording(const string &path);
+        void stopRecording();
+        void setShard(int shardIndex, int shardCount);
+        void enableSharedCapacity();
+        bool isPlanOwned(int planId) const;
+        int getPlanCount() const;
+        void setConstructionDuration(FacilityCategory category, int minimum, int maximum);
+        void enableStochastic(uint64_t seed);
+        const StochasticModel &getConstructionDurations() const;
+        const PublishedState &getPublishedState() const;
+        void enableColdStore(const string &path, int idleTicks);
+        static int getSettlementShard(const string &settlementName, int shardCount);
+        static BaseAction *parseAction(const vector<string> &arguments);
 
     private:
+        friend class SimulationImage;
+        Simulation();
+        Simulation(const Simulation &other);
+        Plan &unsharePlan(int planId);
+        void spillIdlePlans();
+        void queueSelection(Plan &plan, const vector<FacilityType> &options);
+        static int getTotalScore(const Plan &plan);
         bool isRunning;
         int planCounter; //For assigning unique plan IDs
-        vector<BaseAction*> actionsLog;
-        vector<Plan> plans;
-        vector<Settlement*> settlements;
-        vector<FacilityType> facilitiesOptions;
+        long tickCounter; //Number of simulated steps so far
+        int shardIndex, shardCount; //This process only steps plans of settlements in its shard
+        vector<bool> ownedPlans;
+        vector<bool> changedPlans; //Added or unshared since the last checkpoint, what SimulationImage rewrites
+        std::unique_ptr<ScoreRecorder> scoreRecorder; //nullptr unless recording score time series
+        vector<BaseAction*, TrackingAllocator<BaseAction*, MemorySubsystem::ACTION_LOG>> actionsLog;
+        vector<shared_ptr<Plan>, TrackingAllocator<shared_ptr<Plan>, MemorySubsystem::PLAN>> plans; //Shared with forks until changed
+        vector<shared_ptr<Settlement>, TrackingAllocator<shared_ptr<Settlement>, MemorySubsystem::REGISTRY>> settlements;
+        FacilityCatalog facilitiesOptions;
+        StochasticModel durationModel; //Construction times used once stochastic mode is enabled
+        shared_ptr<const StochasticModel> stochasticModel; //nullptr while construction is deterministic
+        uint64_t stochasticSeed;
+        PublishedState publishedState; //Plan summaries as of the last tick, safe to read from any thread
+        bool isPublishing; //Forks are not read by other threads and skip publishing
+        std::unique_ptr<ColdStore> coldStore; //nullptr unless idle plans are spilled to disk
+        int coldAfterTicks;
+        vector<Plan*> batchPlans; //Scratch space of the batched selection stage, see step()
+        vector<BalancedSelection*> batchPolicies;
+        vector<int> batchSelections;
+        std::unique_ptr<SimulationImage> image; //nullptr unless checkpointing to an image file
+        int imageEveryTicks;
+        std::unique_ptr<ConstructionScheduler> scheduler; //nullptr while each plan has its settlement's full capacity
+        vector<int> admittedPlans;
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+using std::string;
+
+class Settlement;
+class Simulation;
+
+// Where the state of one committed checkpoint lives in the arena
+struct ImageRoot {
+    uint64_t generation; //0 if the root was never written
+    int64_t tick;
+    uint64_t arenaEnd; //Bytes of the file in use, new records go after them
+    uint64_t tables; //Settlements, catalog and their names, rewritten only when they grow
+    uint64_t tablesCapacity;
+    int32_t settlementCount;
+    int32_t facilityTypeCount;
+    uint64_t planTable; //One slot per plan at a stable offset, moved only when it runs out of room
+    uint32_t planCapacity;
+    uint32_t planCount;
+    int32_t stochastic;
+    uint64_t stochasticSeed;
+    int32_t minimumDuration[3];
+    int32_t maximumDuration[3];
+    uint64_t checksum; //FNV-1a of the fields above
+};
+
+struct ImageHeader {
+    uint32_t magic;
+    uint32_t formatVersion;
+    ImageRoot roots[2];
+};
+
+// Memory-mapped arena holding the simulation's state at tick boundaries: the
+// settlements, the catalog, and every plan with its policy, facilities under
+// construction and operational runs, as plain records linked by offset.
+//
+// Each plan has a slot with two copies of its record, each stamped with the
+// generation that wrote it, and each with its own extent of runs. A checkpoint
+// only rewrites the plans changed since the previous one, into the copy the
+// committed root does not use, flushes them with msync and then commits by
+// writing the other root in the header page with the next generation. A plan's
+// record is its newest copy not newer than the root, so a crash at any point
+// leaves the previous checkpoint intact; open() takes the newest root whose
+// checksum holds. Extents and tables that were outgrown are not reclaimed.
+class SimulationImage {
+    public:
+        SimulationImage(const string &path);
+        SimulationImage(const SimulationImage &other) = delete;
+        SimulationImage &operator=(const SimulationImage &other) = delete;
+        ~SimulationImage();
+        bool hasCheckpoint() const;
+        uint64_t getGeneration() const;
+        void checkpoint(Simulation &simulation);
+        void restore(Simulation &simulation);
+
+    private:
+        const ImageRoot *committedRoot() const;
+        void dropUncommitted();
+        uint64_t allocate(ImageRoot &root, size_t size);
+        void reserve(size_t size);
+        ImageHeader &header() const;
+        template <typename T> T *at(uint64_t offset) const {
+            return reinterpret_cast<T*>(base + offset);
+        }
+        int fd;
+        char *base;
+        size_t mappedSize;
+        bool inSync; //The committed root holds this simulation's tables and every plan not marked changed
+        std::unordered_map<const Settlement*, int32_t> settlementIndices; //Extended as the simulation adds settlements
+};
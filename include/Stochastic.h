@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include "Facility.h"
+
+// Small seedable random stream (splitmix64). Each plan owns one, so a run is
+// reproducible from its seed no matter how runs are spread over threads.
+class RandomStream {
+    public:
+        RandomStream(uint64_t seed = 0);
+        uint64_t next();
+        uint64_t getState() const; //RandomStream(getState()) continues where this one is
+        int nextInt(int minimum, int maximum); //Uniform in [minimum, maximum]
+        static uint64_t mix(uint64_t seed, uint64_t stream); //Derives independent per-plan seeds
+
+    private:
+        uint64_t state;
+};
+
+// Construction time of new facilities, drawn uniformly per category.
+// A range of a single value is a fixed duration; the default is 10 for every category.
+class StochasticModel {
+    public:
+        StochasticModel();
+        void setDuration(FacilityCategory category, int minimum, int maximum);
+        int drawDuration(FacilityCategory category, RandomStream &random) const;
+        int getMinimum(FacilityCategory category) const;
+        int getMaximum(FacilityCategory category) const;
+        const string toString() const;
+
+    private:
+        static const int categoryCount = 3;
+        int minimumDuration[categoryCount];
+        int maximumDuration[categoryCount];
+};
@@ -0,0 +1,61 @@
+#pragma once
+#include <atomic>
+#include <string>
+using std::string;
+
+// Scoped spans recorded into per-thread ring buffers and exported as
+// Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Build with -DSIMULATION_NO_TRACING to compile the spans out entirely;
+// otherwise a disabled tracer costs one relaxed load and branch per span.
+class Trace {
+    public:
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+        static void enable();
+        static void disable();
+        static long long now(); //Nanoseconds, steady clock
+        static void record(const char *name, long long start, long long end);
+        static bool shouldSample(int sampleEvery);
+        static bool writeChromeTrace(const string &path);
+
+    private:
+        static std::atomic<bool> enabled;
+};
+
+class TraceSpan {
+    public:
+        TraceSpan(const char *name) : name(Trace::isEnabled() ? name : nullptr), start(0) {
+            if (this->name != nullptr) {
+                start = Trace::now();
+            }
+        }
+        // Only one in sampleEvery spans of this thread is recorded
+        TraceSpan(const char *name, int sampleEvery)
+            : name(Trace::isEnabled() && Trace::shouldSample(sampleEvery) ? name : nullptr), start(0) {
+            if (this->name != nullptr) {
+                start = Trace::now();
+            }
+        }
+        TraceSpan(const TraceSpan &other) = delete;
+        TraceSpan &operator=(const TraceSpan &other) = delete;
+        ~TraceSpan() {
+            if (name != nullptr) {
+                Trace::record(name, start, Trace::now());
+            }
+        }
+
+    private:
+        const char *name;
+        long long start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef SIMULATION_NO_TRACING
+#define TRACE_SCOPE(name)
+#define TRACE_SAMPLED_SCOPE(name, sampleEvery)
+#else
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SAMPLED_SCOPE(name, sampleEvery) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, sampleEvery)
+#endif
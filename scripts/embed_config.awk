@@ -0,0 +1,28 @@
+# Turns a simulation config file into a header of constexpr arrays, see CompiledCatalog.h
+# usage: awk -f scripts/embed_config.awk config_file.txt > EmbeddedCatalog.h
+{ sub(/\r$/, "") }
+/^[ \t]*(#|$)/ { next }
+$1 == "facility" {
+    facilities = facilities sprintf("    CatalogEntry{\"%s\", static_cast<FacilityCategory>(%d), %d, %d, %d, %d},\n", $2, $3, $4, $5, $6, $7)
+    facilityCount++
+}
+$1 == "settlement" {
+    settlements = settlements sprintf("    SettlementEntry{\"%s\", static_cast<SettlementType>(%d)},\n", $2, $3)
+    settlementCount++
+}
+$1 == "plan" {
+    plans = plans sprintf("    PlanEntry{\"%s\", \"%s\"},\n", $2, $3)
+    planCount++
+}
+$1 == "duration" {
+    durations = durations sprintf("    DurationEntry{static_cast<FacilityCategory>(%d), %d, %d},\n", $2, $3, $4)
+    durationCount++
+}
+END {
+    printf "#pragma once\n// Generated from %s by scripts/embed_config.awk, do not edit\n", FILENAME
+    printf "#include <array>\n#include \"CompiledCatalog.h\"\n\n"
+    printf "constexpr std::array<CatalogEntry, %d> embeddedFacilities = {{\n%s}};\n\n", facilityCount, facilities
+    printf "constexpr std::array<SettlementEntry, %d> embeddedSettlements = {{\n%s}};\n\n", settlementCount, settlements
+    printf "constexpr std::array<PlanEntry, %d> embeddedPlans = {{\n%s}};\n\n", planCount, plans
+    printf "constexpr std::array<DurationEntry, %d> embeddedDurations = {{\n%s}};\n", durationCount, durations
+}
@@ -1,8 +1,14 @@
 #include "Action.h"
 #include "Auxiliary.h"
+#include "Trace.h"
+#include "ForkEvaluator.h"
+#include "MonteCarlo.h"
+#include "PerfCounters.h"
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
+#include <thread>
+#include <utility>
 
 
 
@@ -30,14 +36,50 @@ const string &BaseAction::getErrorMsg() const {
     return errorMsg;
 }
 
+// Most actions are short, they simply run to completion
+bool BaseAction::resume(Simulation &simulation, int) {
+    act(simulation);
+    return true;
+}
+
+void BaseAction::cancel() {}
+
+// Read-only actions may be served while a long action is still in flight
+bool BaseAction::isReadOnly() const {
+    return false;
+}
+
 
-SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps) {}
+SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps), stepsLeft(numOfSteps), cancelled(false) {}
 
 void SimulateStep::act(Simulation &simulation) {
-    for (int i = 0; i < numOfSteps; i++) {
+    TRACE_SCOPE("SimulateStep::act");
+    resume(simulation, stepsLeft);
+}
+
+// Steps are always taken whole, so the simulation is at a tick boundary between calls
+bool SimulateStep::resume(Simulation &simulation, int tickBudget) {
+    TRACE_SCOPE("SimulateStep::resume");
+    while (stepsLeft > 0 && tickBudget > 0 && !cancelled) {
         simulation.step();
+        stepsLeft--;
+        tickBudget--;
+    }
+    if (cancelled) {
+        stringstream ss;
+        ss << "Step cancelled after " << numOfSteps - stepsLeft << " steps";
+        error(ss.str());
+        return true;
+    }
+    if (stepsLeft > 0) {
+        return false;
     }
     complete();
+    return true;
+}
+
+void SimulateStep::cancel() {
+    cancelled = true;
 }
 
 const string SimulateStep::toString() const {
@@ -55,6 +97,7 @@ AddPlan::AddPlan(const string &settlementName, const string &selectionPolicy)
     : settlementName(settlementName), selectionPolicy(selectionPolicy) {}
 
 void AddPlan::act(Simulation &simulation) {
+    TRACE_SCOPE("AddPlan::act");
     try {
         Settlement *settlement = simulation.getSettlement(settlementName);
         SelectionPolicy *policy = nullptr;
@@ -67,6 +110,8 @@ void AddPlan::act(Simulation &simulation) {
             policy = new EconomySelection();
         } else if (selectionPolicy == "env") {
             policy = new SustainabilitySelection();
+        } else if (selectionPolicy == "rnd") {
+            policy = new RandomSelection();
         } else {
             throw runtime_error("Invalid selection policy");
         }
@@ -93,6 +138,7 @@ AddSettlement::AddSettlement(const string &settlementName, SettlementType settle
     : settlementName(settlementName), settlementType(settlementType) {}
 
 void AddSettlement::act(Simulation &simulation) {
+    TRACE_SCOPE("AddSettlement::act");
     Settlement *settlement = new Settlement(settlementName, settlementType);
 
     if (!simulation.addSettlement(settlement)) {
@@ -119,6 +165,7 @@ AddFacility::AddFacility(const string &facilityName, const FacilityCategory faci
     : facilityName(facilityName), facilityCategory(facilityCategory), price(price), lifeQualityScore(lifeQualityScore), economyScore(economyScore), environmentScore(environmentScore) {}
 
 void AddFacility::act(Simulation &simulation) {
+    TRACE_SCOPE("AddFacility::act");
     FacilityType facility(facilityName, facilityCategory, price, lifeQualityScore, economyScore, environmentScore);
 
     if (!simulation.addFacility(facility)) {
@@ -143,10 +190,16 @@ AddFacility *AddFacility::clone() const {
 
 PrintPlanStatus::PrintPlanStatus(int planId) : planId(planId) {}
 
+bool PrintPlanStatus::isReadOnly() const {
+    return true;
+}
+
 void PrintPlanStatus::act(Simulation &simulation) {
+    TRACE_SCOPE("PrintPlanStatus::act");
     try {
-        Plan &plan = simulation.getPlan(planId);
-        plan.printStatus();
+        const Plan &plan = std::as_const(simulation).getPlan(planId);
+        shared_ptr<const FacilityCatalog::Snapshot> catalog = simulation.getFacilityCatalog().pin();
+        plan.printStatus(catalog->getOptions());
         complete();
     } catch (const runtime_error &e) {
         error("Plan does not exist");
@@ -169,6 +222,7 @@ ChangePlanPolicy::ChangePlanPolicy(const int planId, const string &newPolicy)
     : planId(planId), newPolicy(newPolicy) {}
 
 void ChangePlanPolicy::act(Simulation &simulation) {
+    TRACE_SCOPE("ChangePlanPolicy::act");
     try {
         Plan &plan = simulation.getPlan(planId);
         SelectionPolicy *policy = nullptr;
@@ -181,6 +235,8 @@ void ChangePlanPolicy::act(Simulation &simulation) {
             policy = new EconomySelection();
         } else if (newPolicy == "env") {
             policy = new SustainabilitySelection();
+        } else if (newPolicy == "rnd") {
+            policy = new RandomSelection();
         } else {
             throw runtime_error("Invalid selection policy");
         }
@@ -200,4 +256,238 @@ const string ChangePlanPolicy::toString() const {
 
 ChangePlanPolicy *ChangePlanPolicy::clone() const {
     return new ChangePlanPolicy(*this);
-}
\ No newline at end of file
+}
+
+
+PrintPlanScores::PrintPlanScores() {}
+
+bool PrintPlanScores::isReadOnly() const {
+    return true;
+}
+
+// One "<planId> <lifeQuality> <economy> <environment>" line per plan this process steps
+void PrintPlanScores::act(Simulation &simulation) {
+    TRACE_SCOPE("PrintPlanScores::act");
+    for (int planId = 0; planId < simulation.getPlanCount(); planId++) {
+        if (simulation.isPlanOwned(planId)) {
+            const Plan &plan = std::as_const(simulation).getPlan(planId);
+            cout << planId << " " << plan.getlifeQualityScore() << " " << plan.getEconomyScore() << " " << plan.getEnvironmentScore() << endl;
+        }
+    }
+    complete();
+}
+
+const string PrintPlanScores::toString() const {
+    return "PrintPlanScores";
+}
+
+PrintPlanScores *PrintPlanScores::clone() const {
+    return new PrintPlanScores(*this);
+}
+
+
+
+EvaluatePolicies::EvaluatePolicies(const int planId, const int numOfSteps) : planId(planId), numOfSteps(numOfSteps) {}
+
+bool EvaluatePolicies::isReadOnly() const {
+    return true;
+}
+
+void EvaluatePolicies::act(Simulation &simulation) {
+    TRACE_SCOPE("EvaluatePolicies::act");
+    try {
+        std::as_const(simulation).getPlan(planId);
+    } catch (const runtime_error &e) {
+        error("Plan does not exist");
+        return;
+    }
+
+    const vector<string> policies = {"nve", "bal", "eco", "env"};
+    vector<std::function<void(Simulation&)>> alternatives;
+    for (const string &policy : policies) {
+        int id = planId;
+        alternatives.push_back([id, policy](Simulation &fork) {
+            ChangePlanPolicy change(id, policy);
+            change.act(fork);
+        });
+    }
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    vector<ForkOutcome> outcomes = ForkEvaluator::run(simulation, alternatives, numOfSteps, threadCount);
+
+    for (size_t i = 0; i < policies.size(); i++) {
+        cout << policies[i] << ": Life Quality Score: " << outcomes[i].lifeQualityScores[planId]
+             << ", Economy Score: " << outcomes[i].economyScores[planId]
+             << ", Environment Score: " << outcomes[i].environmentScores[planId] << endl;
+    }
+    complete();
+}
+
+const string EvaluatePolicies::toString() const {
+    stringstream ss;
+    ss << "EvaluatePolicies " << planId << " " << numOfSteps;
+    return ss.str();
+}
+
+EvaluatePolicies *EvaluatePolicies::clone() const {
+    return new EvaluatePolicies(*this);
+}
+
+
+
+PrintMemoryUsage::PrintMemoryUsage() {}
+
+bool PrintMemoryUsage::isReadOnly() const {
+    return true;
+}
+
+void PrintMemoryUsage::act(Simulation &simulation) {
+    TRACE_SCOPE("PrintMemoryUsage::act");
+    cout << MemoryAccounting::toString(simulation.getTick());
+    complete();
+}
+
+const string PrintMemoryUsage::toString() const {
+    return "PrintMemoryUsage";
+}
+
+PrintMemoryUsage *PrintMemoryUsage::clone() const {
+    return new PrintMemoryUsage(*this);
+}
+
+
+
+ExportTrace::ExportTrace(const string &path) : path(path) {}
+
+bool ExportTrace::isReadOnly() const {
+    return true;
+}
+
+void ExportTrace::act(Simulation &) {
+    TRACE_SCOPE("ExportTrace::act");
+    if (!Trace::writeChromeTrace(path)) {
+        error("Cannot write trace file");
+        return;
+    }
+    complete();
+}
+
+const string ExportTrace::toString() const {
+    return "ExportTrace " + path;
+}
+
+ExportTrace *ExportTrace::clone() const {
+    return new ExportTrace(*this);
+}
+
+
+
+PrintPerfCounters::PrintPerfCounters(bool reset) : reset(reset) {}
+
+bool PrintPerfCounters::isReadOnly() const {
+    return true;
+}
+
+void PrintPerfCounters::act(Simulation &) {
+    TRACE_SCOPE("PrintPerfCounters::act");
+    cout << PerfCounters::toJson() << endl;
+    if (reset) {
+        PerfCounters::reset();
+    }
+    complete();
+}
+
+const string PrintPerfCounters::toString() const {
+    return reset ? "PrintPerfCounters reset" : "PrintPerfCounters";
+}
+
+PrintPerfCounters *PrintPerfCounters::clone() const {
+    return new PrintPerfCounters(*this);
+}
+
+
+
+SetConstructionDuration::SetConstructionDuration(FacilityCategory category, int minimum, int maximum)
+    : category(category), minimum(minimum), maximum(maximum) {}
+
+void SetConstructionDuration::act(Simulation &simulation) {
+    TRACE_SCOPE("SetConstructionDuration::act");
+    try {
+        simulation.setConstructionDuration(category, minimum, maximum);
+        complete();
+    } catch (const runtime_error &e) {
+        error("Invalid construction duration");
+    }
+}
+
+const string SetConstructionDuration::toString() const {
+    stringstream ss;
+    ss << "SetConstructionDuration " << static_cast<int>(category) << " " << minimum << " " << maximum;
+    return ss.str();
+}
+
+SetConstructionDuration *SetConstructionDuration::clone() const {
+    return new SetConstructionDuration(*this);
+}
+
+
+
+EnableStochastic::EnableStochastic(uint64_t seed) : seed(seed) {}
+
+void EnableStochastic::act(Simulation &simulation) {
+    TRACE_SCOPE("EnableStochastic::act");
+    simulation.enableStochastic(seed);
+    complete();
+}
+
+const string EnableStochastic::toString() const {
+    stringstream ss;
+    ss << "EnableStochastic " << seed;
+    return ss.str();
+}
+
+EnableStochastic *EnableStochastic::clone() const {
+    return new EnableStochastic(*this);
+}
+
+
+
+RunMonteCarlo::RunMonteCarlo(const int runs, const int numOfSteps, uint64_t seed) : runs(runs), numOfSteps(numOfSteps), seed(seed) {}
+
+bool RunMonteCarlo::isReadOnly() const {
+    return true;
+}
+
+void RunMonteCarlo::act(Simulation &simulation) {
+    TRACE_SCOPE("RunMonteCarlo::act");
+    if (runs < 1 || numOfSteps < 0) {
+        error("Invalid number of runs or steps");
+        return;
+    }
+    int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    MonteCarloReport report = MonteCarlo::run(simulation, runs, numOfSteps, seed, threadCount);
+
+    auto printDistribution = [](const string &name, const ScoreDistribution &distribution) {
+        cout << name << ": mean " << distribution.mean << ", p5 " << distribution.p5
+             << ", p50 " << distribution.p50 << ", p95 " << distribution.p95 << endl;
+    };
+    cout << "Runs: " << runs << ", Steps: " << numOfSteps << ", Construction durations: "
+         << simulation.getConstructionDurations().toString() << endl;
+    for (const PlanDistribution &plan : report.plans) {
+        cout << "PlanID: " << plan.planId << endl;
+        printDistribution("Life Quality Score", plan.lifeQuality);
+        printDistribution("Economy Score", plan.economy);
+        printDistribution("Environment Score", plan.environment);
+    }
+    cout << "Throughput: " << static_cast<long>(report.planTicksPerSecond) << " plan-ticks/s" << endl;
+    complete();
+}
+
+const string RunMonteCarlo::toString() const {
+    stringstream ss;
+    ss << "RunMonteCarlo " << runs << " " << numOfSteps << " " << seed;
+    return ss.str();
+}
+
+RunMonteCarlo *RunMonteCarlo::clone() const {
+    return new RunMonteCarlo(*this);
+}
@@ -0,0 +1,58 @@
+#include "ColdStore.h"
+#include "Plan.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdexcept>
+
+ColdStore::ColdStore(const string &path)
+    : fd(-1), size(0) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open cold store " + path);
+    }
+}
+
+ColdStore::~ColdStore() {
+    ::close(fd);
+}
+
+// Where the runs will be once flushed
+ColdSegment ColdStore::stage(const vector<OperationalFacilities, TrackingAllocator<OperationalFacilities, MemorySubsystem::PLAN>> &runs) {
+    int64_t offset = size + staged.size() * sizeof(int32_t);
+    int32_t facilityCount = 0;
+    for (const OperationalFacilities &run : runs) {
+        staged.push_back(run.typeIndex);
+        staged.push_back(run.count);
+        facilityCount += run.count;
+    }
+    return ColdSegment{offset, static_cast<int32_t>(runs.size()), facilityCount};
+}
+
+// Append everything staged since the last flush with a single write
+void ColdStore::flush() {
+    if (staged.empty()) {
+        return;
+    }
+    size_t bytes = staged.size() * sizeof(int32_t);
+    if (::pwrite(fd, staged.data(), bytes, size) != static_cast<ssize_t>(bytes)) {
+        throw std::runtime_error("Cannot write to cold store");
+    }
+    size += bytes;
+    staged.clear();
+}
+
+void ColdStore::read(const ColdSegment &segment, vector<OperationalFacilities, TrackingAllocator<OperationalFacilities, MemorySubsystem::PLAN>> &runs) const {
+    vector<int32_t> record(segment.runs * 2);
+    size_t bytes = record.size() * sizeof(int32_t);
+    if (::pread(fd, record.data(), bytes, segment.offset) != static_cast<ssize_t>(bytes)) {
+        throw std::runtime_error("Cannot read from cold store");
+    }
+    runs.reserve(runs.size() + segment.runs);
+    for (size_t i = 0; i < record.size(); i += 2) {
+        runs.push_back(OperationalFacilities(record[i], record[i + 1]));
+    }
+}
+
+int64_t ColdStore::getSize() const {
+    return size;
+}
@@ -0,0 +1,64 @@
+#include "CommandQueue.h"
+
+Command::Command(const string &line, const shared_ptr<ClientSession> &client)
+    : line(line), client(client), next(nullptr) {}
+
+CommandQueue::CommandQueue() : stub("", nullptr), head(&stub), tail(&stub), size(0) {}
+
+CommandQueue::~CommandQueue() {
+    Command *command;
+    while ((command = pop()) != nullptr) {
+        delete command;
+    }
+}
+
+void CommandQueue::link(Command *command) {
+    command->next.store(nullptr, std::memory_order_relaxed);
+    Command *previous = head.exchange(command, std::memory_order_acq_rel);
+    previous->next.store(command, std::memory_order_release);
+}
+
+void CommandQueue::push(Command *command) {
+    link(command);
+    size.fetch_add(1);
+}
+
+Command *CommandQueue::pop() {
+    Command *first = tail;
+    Command *next = first->next.load(std::memory_order_acquire);
+
+    // Skip the stub node
+    if (first == &stub) {
+        if (next == nullptr) {
+            return nullptr;
+        }
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != nullptr) {
+        tail = next;
+        size.fetch_sub(1);
+        return first;
+    }
+
+    // A producer swapped the head but did not link it yet, try again later
+    if (first != head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+
+    // Last real node, put the stub behind it so it can be detached
+    link(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        size.fetch_sub(1);
+        return first;
+    }
+    return nullptr;
+}
+
+bool CommandQueue::isEmpty() const {
+    return size.load() <= 0;
+}
@@ -0,0 +1,298 @@
+#include "CommandServer.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Auxiliary.h"
+#include <iostream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ================== ClientSession ==================
+ClientSession::ClientSession(int fd) : fd(fd), buffer("") {}
+
+ClientSession::~ClientSession() {
+    ::close(fd);
+}
+
+// Blocks until a full line arrives, returns false once the client is gone
+bool ClientSession::readLine(string &line) {
+    while (true) {
+        size_t end = buffer.find('\n');
+        if (end != string::npos) {
+            line = buffer.substr(0, end);
+            buffer.erase(0, end + 1);
+            return true;
+        }
+        char chunk[4096];
+        ssize_t received = ::read(fd, chunk, sizeof(chunk));
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, received);
+    }
+}
+
+void ClientSession::reply(const string &text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t written = ::send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return; // Client disconnected, nobody is waiting for this reply
+        }
+        sent += written;
+    }
+}
+
+void ClientSession::shutdown() {
+    ::shutdown(fd, SHUT_RDWR);
+}
+
+// ================== CommandServer ==================
+CommandServer::CommandServer(Simulation &simulation, const string &socketPath)
+    : simulation(simulation), socketPath(socketPath), listenFd(-1), queue(), inFlight(nullptr), inFlightClient(), inFlightOutput(""), deferred(), running(false), waiting(false) {
+    sockaddr_un address;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long");
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, socketPath.c_str());
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error("Cannot create socket");
+    }
+    ::unlink(socketPath.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listenFd, SOMAXCONN) < 0) {
+        ::close(listenFd);
+        throw std::runtime_error("Cannot listen on " + socketPath);
+    }
+}
+
+CommandServer::~CommandServer() {
+    stop();
+    abandonPending();
+    ::close(listenFd);
+    ::unlink(socketPath.c_str());
+}
+
+void CommandServer::run() {
+    running = true;
+    acceptor = std::thread(&CommandServer::acceptClients, this);
+    while (running) {
+        int executed = drain();
+        if (inFlight != nullptr) {
+            advance();
+        } else if (executed == 0) {
+            waitForCommands();
+        }
+    }
+    stop();
+}
+
+void CommandServer::stop() {
+    running = false;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeUp.notify_all();
+    }
+    ::shutdown(listenFd, SHUT_RDWR);
+    if (acceptor.joinable()) {
+        acceptor.join();
+    }
+    // Joined without clientsMutex, the reader threads take it to mark themselves finished
+    std::list<ClientConnection> stopping;
+    {
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        for (ClientConnection &connection : clients) {
+            if (shared_ptr<ClientSession> session = connection.session.lock()) {
+                session->shutdown();
+            }
+        }
+        stopping.splice(stopping.end(), clients);
+    }
+    for (ClientConnection &connection : stopping) {
+        connection.thread.join();
+    }
+}
+
+void CommandServer::acceptClients() {
+    while (running) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return; // The listening socket was shut down
+        }
+        shared_ptr<ClientSession> client(new ClientSession(fd));
+        std::lock_guard<std::mutex> lock(clientsMutex);
+        reapClients();
+        clients.push_back(ClientConnection{std::thread(), client, false});
+        std::list<ClientConnection>::iterator connection = std::prev(clients.end());
+        connection->thread = std::thread(&CommandServer::serveClient, this, client, connection);
+    }
+}
+
+// Join the reader threads of clients that disconnected, called with clientsMutex held
+void CommandServer::reapClients() {
+    for (std::list<ClientConnection>::iterator connection = clients.begin(); connection != clients.end();) {
+        if (connection->finished) {
+            connection->thread.join();
+            connection = clients.erase(connection);
+        } else {
+            ++connection;
+        }
+    }
+}
+
+void CommandServer::serveClient(shared_ptr<ClientSession> client, std::list<ClientConnection>::iterator connection) {
+    string line;
+    while (client->readLine(line)) {
+        submit(new Command(line, client));
+    }
+    std::lock_guard<std::mutex> lock(clientsMutex);
+    connection->finished = true;
+}
+
+void CommandServer::submit(Command *command) {
+    queue.push(command);
+    // Only pay for the mutex when the simulation thread is actually asleep
+    if (waiting.load()) {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeUp.notify_one();
+    }
+}
+
+void CommandServer::waitForCommands() {
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    waiting = true;
+    while (running && queue.isEmpty()) {
+        wakeUp.wait(lock);
+    }
+    waiting = false;
+}
+
+// Execute up to maxBatch queued commands, returns how many were executed
+int CommandServer::drain() {
+    int executed = 0;
+    Command *command;
+    while (executed < maxBatch && (command = queue.pop()) != nullptr) {
+        execute(*command);
+        delete command;
+        executed++;
+    }
+    return executed;
+}
+
+void CommandServer::execute(const Command &command) {
+    vector<string> arguments = Auxiliary::parseArguments(command.line);
+    if (arguments.empty()) {
+        return;
+    }
+    if (arguments[0] == "close") {
+        abandonPending();
+        running = false;
+        command.client->reply("COMPLETED\n");
+        return;
+    }
+    if (arguments[0] == "cancel") {
+        if (inFlight == nullptr) {
+            command.client->reply("Error: Nothing to cancel\nERROR\n");
+            return;
+        }
+        inFlight->cancel();
+        command.client->reply("COMPLETED\n");
+        return;
+    }
+
+    BaseAction *action = Simulation::parseAction(arguments);
+    if (action == nullptr) {
+        command.client->reply("Error: Unknown command\nERROR\n");
+        return;
+    }
+
+    // Anything that changes the simulation keeps its order behind the in-flight action,
+    // and so does anything sent after an action of the same client that is still waiting
+    if (inFlight != nullptr && (!action->isReadOnly() || hasPending(command.client))) {
+        deferred.push_back(PendingAction{action, command.client});
+        return;
+    }
+    start(action, command.client);
+}
+
+// Whether an earlier action of this client is in flight or waiting for it
+bool CommandServer::hasPending(const shared_ptr<ClientSession> &client) const {
+    if (inFlightClient == client) {
+        return true;
+    }
+    for (const PendingAction &pending : deferred) {
+        if (pending.client == client) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Actions print to cout, hand that output back to the client that asked
+static string captureOutput(const std::function<void()> &run) {
+    std::stringstream output;
+    std::streambuf *console = std::cout.rdbuf(output.rdbuf());
+    run();
+    std::cout.rdbuf(console);
+    return output.str();
+}
+
+void CommandServer::start(BaseAction *action, const shared_ptr<ClientSession> &client) {
+    bool done = false;
+    string output = captureOutput([&]() { done = action->resume(simulation, ticksPerSlice); });
+    if (done) {
+        finish(action, client, output);
+        return;
+    }
+    inFlight = action;
+    inFlightClient = client;
+    inFlightOutput = output;
+}
+
+// Run one more slice of the in-flight action, then the actions that waited for it
+void CommandServer::advance() {
+    bool done = false;
+    inFlightOutput += captureOutput([&]() { done = inFlight->resume(simulation, ticksPerSlice); });
+    if (!done) {
+        return;
+    }
+    BaseAction *action = inFlight;
+    shared_ptr<ClientSession> client = inFlightClient;
+    inFlight = nullptr;
+    inFlightClient.reset();
+    finish(action, client, inFlightOutput);
+
+    while (inFlight == nullptr && !deferred.empty()) {
+        PendingAction pending = deferred.front();
+        deferred.pop_front();
+        start(pending.action, pending.client);
+    }
+}
+
+void CommandServer::finish(BaseAction *action, const shared_ptr<ClientSession> &client, const string &output) {
+    simulation.addAction(action);
+    client->reply(output + (action->getStatus() == ActionStatus::COMPLETED ? "COMPLETED" : "ERROR") + "\n");
+}
+
+// On close the in-flight action is cancelled and whatever waited behind it is dropped
+void CommandServer::abandonPending() {
+    if (inFlight != nullptr) {
+        inFlight->cancel();
+        inFlightOutput += captureOutput([&]() { inFlight->resume(simulation, 0); });
+        finish(inFlight, inFlightClient, inFlightOutput);
+        inFlight = nullptr;
+        inFlightClient.reset();
+    }
+    for (PendingAction &pending : deferred) {
+        pending.client->reply("Error: Simulation closed\nERROR\n");
+        delete pending.action;
+    }
+    deferred.clear();
+}
@@ -0,0 +1,77 @@
+#include "ConstructionScheduler.h"
+#include <stdexcept>
+
+int ConstructionScheduler::getCapacity(SettlementType type) {
+    if (type == SettlementType::VILLAGE) {
+        return 1;
+    } else if (type == SettlementType::CITY) {
+        return 2;
+    }
+    return 3;
+}
+
+void ConstructionScheduler::addSettlement(const Settlement &settlement) {
+    if (indices.count(&settlement) == 0) {
+        indices[&settlement] = queues.size();
+        queues.push_back(SettlementQueue{getCapacity(settlement.getType()), 0, false, {}});
+    }
+}
+
+ConstructionScheduler::SettlementQueue &ConstructionScheduler::queueOf(const Settlement &settlement) {
+    addSettlement(settlement);
+    return queues[indices.at(&settlement)];
+}
+
+void ConstructionScheduler::enqueue(int planId, const Settlement &settlement, int totalScore) {
+    if (isQueued(planId)) {
+        return;
+    }
+    if (planId >= (int)queued.size()) {
+        queued.resize(planId + 1, false);
+    }
+    queued[planId] = true;
+    queueOf(settlement).waiting.push(Entry(totalScore, planId));
+    updateReady(indices.at(&settlement));
+}
+
+bool ConstructionScheduler::isQueued(int planId) const {
+    return planId < (int)queued.size() && queued[planId];
+}
+
+void ConstructionScheduler::build(const Settlement &settlement, int count) {
+    queueOf(settlement).inUse += count;
+}
+
+void ConstructionScheduler::release(const Settlement &settlement, int count) {
+    SettlementQueue &queue = queueOf(settlement);
+    queue.inUse -= count;
+    if (queue.inUse < 0) {
+        throw std::runtime_error("Settlement capacity released twice");
+    }
+    updateReady(indices.at(&settlement));
+}
+
+// Hands out every free slot of the ready settlements, one facility per admitted plan
+void ConstructionScheduler::admit(vector<int> &planIds) {
+    planIds.clear();
+    for (int index : ready) {
+        SettlementQueue &queue = queues[index];
+        while (queue.inUse < queue.capacity && !queue.waiting.empty()) {
+            int planId = queue.waiting.top().second;
+            queue.waiting.pop();
+            queued[planId] = false;
+            queue.inUse++;
+            planIds.push_back(planId);
+        }
+        queue.isReady = false;
+    }
+    ready.clear();
+}
+
+void ConstructionScheduler::updateReady(int index) {
+    SettlementQueue &queue = queues[index];
+    if (!queue.isReady && queue.inUse < queue.capacity && !queue.waiting.empty()) {
+        queue.isReady = true;
+        ready.push_back(index);
+    }
+}
@@ -38,6 +38,9 @@ Facility::Facility(const string &name, const string &settlementName, const Facil
 Facility::Facility(const FacilityType &type, const string &settlementName)
     : FacilityType(type), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(10) {}
 
+Facility::Facility(const FacilityType &type, const string &settlementName, FacilityStatus status, int timeLeft)
+    : FacilityType(type), settlementName(settlementName), status(status), timeLeft(timeLeft) {}
+
 // Facility Getters
 const string &Facility::getSettlementName() const {
     return settlementName;
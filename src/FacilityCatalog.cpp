@@ -0,0 +1,79 @@
+#include "FacilityCatalog.h"
+#include <unordered_set>
+#include <utility>
+
+FacilityCatalog::Snapshot::Snapshot(vector<FacilityType> options, long version)
+    : options(std::move(options)), version(version) {
+    // The options buffer is a plain vector, account for it by hand
+    MemoryAccounting::recordAllocation(MemorySubsystem::REGISTRY, this->options.capacity() * sizeof(FacilityType));
+}
+
+FacilityCatalog::Snapshot::~Snapshot() {
+    MemoryAccounting::recordDeallocation(MemorySubsystem::REGISTRY, options.capacity() * sizeof(FacilityType));
+}
+
+const vector<FacilityType> &FacilityCatalog::Snapshot::getOptions() const {
+    return options;
+}
+
+long FacilityCatalog::Snapshot::getVersion() const {
+    return version;
+}
+
+FacilityCatalog::FacilityCatalog()
+    : current(new Snapshot(vector<FacilityType>(), 0)) {}
+
+FacilityCatalog::FacilityCatalog(const FacilityCatalog &other)
+    : current(other.pin()) {}
+
+// Grab the current version; it stays alive for as long as the caller holds it
+shared_ptr<const FacilityCatalog::Snapshot> FacilityCatalog::pin() const {
+    return std::atomic_load(&current);
+}
+
+bool FacilityCatalog::isFacilityExists(const string &facilityName) const {
+    for (const FacilityType &facility : pin()->getOptions()) {
+        if (facility.getName() == facilityName) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Publish a new version containing the added facility.
+// Catalog updates come from the simulation thread only, so there is a single writer.
+bool FacilityCatalog::addFacility(const FacilityType &facility) {
+    return addFacilities(vector<FacilityType>(1, facility));
+}
+
+// Publish a single new version containing all the added facilities, so loading
+// a config copies the options once rather than once per facility.
+// Nothing is added if any of the names is already taken.
+bool FacilityCatalog::addFacilities(const vector<FacilityType> &facilities) {
+    shared_ptr<const Snapshot> previous = pin();
+    const vector<FacilityType> &previousOptions = previous->getOptions();
+    std::unordered_set<string> names;
+    for (const FacilityType &existingFacility : previousOptions) {
+        names.insert(existingFacility.getName());
+    }
+    for (const FacilityType &facility : facilities) {
+        if (!names.insert(facility.getName()).second) {
+            return false;
+        }
+    }
+    vector<FacilityType> options;
+    options.reserve(previousOptions.size() + facilities.size());
+    for (const FacilityType &existingFacility : previousOptions) {
+        options.push_back(existingFacility);
+    }
+    for (const FacilityType &facility : facilities) {
+        options.push_back(facility);
+    }
+    shared_ptr<const Snapshot> next(new Snapshot(std::move(options), previous->getVersion() + 1));
+    std::atomic_store(&current, next);
+    return true;
+}
+
+long FacilityCatalog::getVersion() const {
+    return pin()->getVersion();
+}
@@ -0,0 +1,44 @@
+#include "ForkEvaluator.h"
+#include "Simulation.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <utility>
+
+vector<ForkOutcome> ForkEvaluator::run(const Simulation &base, const vector<std::function<void(Simulation&)>> &alternatives, int ticks, int threadCount) {
+    vector<std::unique_ptr<Simulation>> forks;
+    for (size_t i = 0; i < alternatives.size(); i++) {
+        forks.push_back(base.fork());
+    }
+
+    vector<ForkOutcome> outcomes(alternatives.size());
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next.fetch_add(1)) < forks.size()) {
+            Simulation &simulation = *forks[index];
+            alternatives[index](simulation);
+            for (int tick = 0; tick < ticks; tick++) {
+                simulation.step();
+            }
+            ForkOutcome &outcome = outcomes[index];
+            for (int planId = 0; planId < simulation.getPlanCount(); planId++) {
+                const Plan &plan = std::as_const(simulation).getPlan(planId);
+                outcome.lifeQualityScores.push_back(plan.getlifeQualityScore());
+                outcome.economyScores.push_back(plan.getEconomyScore());
+                outcome.environmentScores.push_back(plan.getEnvironmentScore());
+            }
+            forks[index].reset();
+        }
+    };
+
+    vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return outcomes;
+}
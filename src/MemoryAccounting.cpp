@@ -0,0 +1,75 @@
+#include "MemoryAccounting.h"
+#include <sstream>
+
+MemoryAccounting::Counters MemoryAccounting::counters[MemoryAccounting::subsystemCount] = {};
+
+void MemoryAccounting::recordAllocation(MemorySubsystem subsystem, size_t bytes) {
+    Counters &counter = counters[static_cast<int>(subsystem)];
+    long live = counter.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    counter.allocations.fetch_add(1, std::memory_order_relaxed);
+    long peak = counter.peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !counter.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void MemoryAccounting::recordDeallocation(MemorySubsystem subsystem, size_t bytes) {
+    counters[static_cast<int>(subsystem)].liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+long MemoryAccounting::getLiveBytes(MemorySubsystem subsystem) {
+    return counters[static_cast<int>(subsystem)].liveBytes.load(std::memory_order_relaxed);
+}
+
+long MemoryAccounting::getPeakBytes(MemorySubsystem subsystem) {
+    return counters[static_cast<int>(subsystem)].peakBytes.load(std::memory_order_relaxed);
+}
+
+long MemoryAccounting::getAllocations(MemorySubsystem subsystem) {
+    return counters[static_cast<int>(subsystem)].allocations.load(std::memory_order_relaxed);
+}
+
+const string MemoryAccounting::getName(MemorySubsystem subsystem) {
+    switch (subsystem) {
+        case MemorySubsystem::PLAN:
+            return "Plan";
+        case MemorySubsystem::FACILITY:
+            return "Facility";
+        case MemorySubsystem::SELECTION_POLICY:
+            return "SelectionPolicy";
+        case MemorySubsystem::ACTION_LOG:
+            return "ActionLog";
+        case MemorySubsystem::REGISTRY:
+            return "Registry";
+    }
+    return "Unknown";
+}
+
+// One line per subsystem, live bytes are also divided by the number of simulated ticks
+const string MemoryAccounting::toString(long ticks) {
+    std::stringstream ss;
+    for (int i = 0; i < subsystemCount; i++) {
+        MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+        ss << getName(subsystem) << ": live " << getLiveBytes(subsystem)
+           << " bytes, peak " << getPeakBytes(subsystem)
+           << " bytes, allocations " << getAllocations(subsystem);
+        if (ticks > 0) {
+            ss << ", " << getLiveBytes(subsystem) / ticks << " bytes per tick";
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+const string MemoryAccounting::toJson() {
+    std::stringstream ss;
+    ss << "{";
+    for (int i = 0; i < subsystemCount; i++) {
+        MemorySubsystem subsystem = static_cast<MemorySubsystem>(i);
+        ss << (i > 0 ? ", " : "") << "\"" << getName(subsystem) << "\": {"
+           << "\"live_bytes\": " << getLiveBytes(subsystem)
+           << ", \"peak_bytes\": " << getPeakBytes(subsystem)
+           << ", \"allocations\": " << getAllocations(subsystem) << "}";
+    }
+    ss << "}";
+    return ss.str();
+}
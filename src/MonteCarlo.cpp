@@ -0,0 +1,65 @@
+#include "MonteCarlo.h"
+#include "ForkEvaluator.h"
+#include "Simulation.h"
+#include "Stochastic.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+MonteCarloReport MonteCarlo::run(const Simulation &base, int runs, int ticks, uint64_t seed, int threadCount) {
+    TRACE_SCOPE("MonteCarlo::run");
+    const int planCount = base.getPlanCount();
+    const int batchSize = std::max(1, threadCount) * 16;
+    vector<vector<int>> lifeQualityScores(planCount), economyScores(planCount), environmentScores(planCount);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int first = 0; first < runs; first += batchSize) {
+        int last = std::min(runs, first + batchSize);
+        vector<std::function<void(Simulation&)>> alternatives;
+        for (int run = first; run < last; run++) {
+            uint64_t runSeed = RandomStream::mix(seed, run);
+            alternatives.push_back([runSeed](Simulation &fork) {
+                fork.enableStochastic(runSeed);
+            });
+        }
+        vector<ForkOutcome> outcomes = ForkEvaluator::run(base, alternatives, ticks, threadCount);
+        for (const ForkOutcome &outcome : outcomes) {
+            for (int planId = 0; planId < planCount; planId++) {
+                lifeQualityScores[planId].push_back(outcome.lifeQualityScores[planId]);
+                economyScores[planId].push_back(outcome.economyScores[planId]);
+                environmentScores[planId].push_back(outcome.environmentScores[planId]);
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    MonteCarloReport report;
+    long planTicks = 0;
+    for (int planId = 0; planId < planCount; planId++) {
+        if (!base.isPlanOwned(planId)) {
+            continue;
+        }
+        planTicks += static_cast<long>(runs) * ticks;
+        report.plans.push_back(PlanDistribution{planId, summarize(lifeQualityScores[planId]),
+                                                summarize(economyScores[planId]), summarize(environmentScores[planId])});
+    }
+    report.planTicksPerSecond = elapsed.count() > 0 ? planTicks / elapsed.count() : 0;
+    return report;
+}
+
+// Sorts scores in place
+ScoreDistribution MonteCarlo::summarize(vector<int> &scores) {
+    if (scores.empty()) {
+        return ScoreDistribution{0, 0, 0, 0};
+    }
+    std::sort(scores.begin(), scores.end());
+    double sum = 0;
+    for (int score : scores) {
+        sum += score;
+    }
+    auto percentile = [&scores](int p) {
+        return scores[(scores.size() - 1) * p / 100];
+    };
+    return ScoreDistribution{sum / scores.size(), percentile(5), percentile(50), percentile(95)};
+}
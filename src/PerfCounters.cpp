@@ -0,0 +1,182 @@
+#include "PerfCounters.h"
+#include "MemoryAccounting.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+const char *eventNames[PerfCounters::eventCount] = {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+const uint32_t eventTypes[PerfCounters::eventCount] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+
+const uint64_t eventConfigs[PerfCounters::eventCount] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES};
+
+const int regionCount = 2;
+const char *regionNames[regionCount] = {"tick", "selection"};
+
+struct RegionTotals {
+    std::atomic<uint64_t> counts[PerfCounters::eventCount];
+    std::atomic<long> scopes;
+    std::atomic<long> planTicks;
+};
+
+RegionTotals totals[regionCount];
+std::atomic<bool> opened[PerfCounters::eventCount]; //Whether any thread could open the event
+std::mutex errorMutex;
+string unavailableReason; //Why the first thread could not open any counter
+
+// The calling thread's counter group; reads return {nr, time enabled, time running, values...}
+struct CounterGroup {
+    CounterGroup() : leader(-1), failed(false) {
+        for (int i = 0; i < PerfCounters::eventCount; i++) {
+            fds[i] = -1;
+        }
+    }
+    ~CounterGroup() {
+        for (int fd : fds) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+    bool open() {
+        int error = 0;
+        for (int i = 0; i < PerfCounters::eventCount; i++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = eventTypes[i];
+            attr.config = eventConfigs[i];
+            attr.disabled = leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+            if (fds[i] < 0) {
+                error = error != 0 ? error : errno;
+                continue;
+            }
+            if (leader < 0) {
+                leader = fds[i];
+            }
+            opened[i] = true;
+        }
+        if (leader < 0) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            unavailableReason = string("perf_event_open: ") + std::strerror(error);
+            failed = true;
+            return false;
+        }
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+    int fds[PerfCounters::eventCount];
+    int leader;
+    bool failed;
+};
+
+thread_local CounterGroup group;
+
+}
+
+std::atomic<bool> PerfCounters::enabled(false);
+
+void PerfCounters::enable() {
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void PerfCounters::disable() {
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+void PerfCounters::reset() {
+    for (RegionTotals &region : totals) {
+        for (std::atomic<uint64_t> &count : region.counts) {
+            count = 0;
+        }
+        region.scopes = 0;
+        region.planTicks = 0;
+    }
+}
+
+// Values are scaled up by enabled/running time in case the kernel multiplexed the group
+bool PerfCounters::read(uint64_t values[eventCount]) {
+    if (group.failed || (group.leader < 0 && !group.open())) {
+        return false;
+    }
+    uint64_t data[3 + eventCount];
+    ssize_t bytes = ::read(group.leader, data, sizeof(data));
+    if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t)) || data[2] == 0) {
+        return false;
+    }
+    double scale = static_cast<double>(data[1]) / data[2];
+    uint64_t next = 3;
+    for (int i = 0; i < eventCount; i++) {
+        values[i] = group.fds[i] >= 0 && next < 3 + data[0] ? static_cast<uint64_t>(data[next++] * scale) : 0;
+    }
+    return true;
+}
+
+void PerfCounters::add(PerfRegion region, const uint64_t before[eventCount], const uint64_t after[eventCount], long planTicks) {
+    RegionTotals &target = totals[static_cast<int>(region)];
+    for (int i = 0; i < eventCount; i++) {
+        if (after[i] > before[i]) {
+            target.counts[i].fetch_add(after[i] - before[i], std::memory_order_relaxed);
+        }
+    }
+    target.scopes.fetch_add(1, std::memory_order_relaxed);
+    target.planTicks.fetch_add(planTicks, std::memory_order_relaxed);
+}
+
+// Totals, per plan-tick averages and the memory accounting report as one JSON object
+const string PerfCounters::toJson() {
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(3);
+    ss << "{\"enabled\": " << (isEnabled() ? "true" : "false");
+    {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!unavailableReason.empty()) {
+            ss << ", \"unavailable\": \"" << unavailableReason << "\"";
+        }
+    }
+    ss << ", \"regions\": {";
+    for (int r = 0; r < regionCount; r++) {
+        const RegionTotals &region = totals[r];
+        long planTicks = region.planTicks.load();
+        ss << (r > 0 ? ", " : "") << "\"" << regionNames[r] << "\": {\"scopes\": " << region.scopes.load()
+           << ", \"plan_ticks\": " << planTicks << ", \"totals\": {";
+        for (int i = 0; i < eventCount; i++) {
+            ss << (i > 0 ? ", " : "") << "\"" << eventNames[i] << "\": ";
+            if (opened[i]) {
+                ss << region.counts[i].load();
+            } else {
+                ss << "null";
+            }
+        }
+        ss << "}, \"per_plan_tick\": {";
+        for (int i = 0; i < eventCount; i++) {
+            ss << (i > 0 ? ", " : "") << "\"" << eventNames[i] << "\": ";
+            if (opened[i] && planTicks > 0) {
+                ss << static_cast<double>(region.counts[i].load()) / planTicks;
+            } else {
+                ss << "null";
+            }
+        }
+        ss << "}}";
+    }
+    ss << "}, \"memory\": " << MemoryAccounting::toJson() << "}";
+    return ss.str();
+}
@@ -1,16 +1,100 @@
 #include "Plan.h"
+#include "Trace.h"
+#include <atomic>
 #include <iostream>
 #include <sstream> // For stringstream in toString
 using namespace std;
 
+OperationalFacilities::OperationalFacilities(int typeIndex, int count)
+    : typeIndex(typeIndex), count(count) {}
+
+// ================== PlanFacilities ==================
+PlanFacilities::PlanFacilities(const Plan &plan, const vector<FacilityType> &facilitiesOptions, const std::shared_ptr<const OperationalRuns> &operational)
+    : plan(plan), facilitiesOptions(facilitiesOptions), operational(operational) {}
+
+PlanFacilities::Iterator PlanFacilities::begin() const {
+    return Iterator(plan, facilitiesOptions, *operational, 0, 0, 0);
+}
+
+PlanFacilities::Iterator PlanFacilities::end() const {
+    return Iterator(plan, facilitiesOptions, *operational, plan.underConstruction.size(), operational->size(), 0);
+}
+
+int PlanFacilities::size() const {
+    int total = plan.underConstruction.size();
+    for (const OperationalFacilities &run : *operational) {
+        total += run.count;
+    }
+    return total;
+}
+
+PlanFacilities::Iterator::Iterator(const Plan &plan, const vector<FacilityType> &facilitiesOptions, const OperationalRuns &operational,
+                                   int constructionIndex, int operationalIndex, int unit)
+    : plan(plan), facilitiesOptions(facilitiesOptions), operational(operational),
+      constructionIndex(constructionIndex), operationalIndex(operationalIndex), unit(unit) {}
+
+Facility PlanFacilities::Iterator::operator*() const {
+    if (constructionIndex < (int)plan.underConstruction.size()) {
+        return *plan.underConstruction[constructionIndex].facility;
+    }
+    const FacilityType &type = facilitiesOptions.at(operational[operationalIndex].typeIndex);
+    return Facility(type, plan.settlement.getName(), FacilityStatus::OPERATIONAL, 0);
+}
+
+PlanFacilities::Iterator &PlanFacilities::Iterator::operator++() {
+    if (constructionIndex < (int)plan.underConstruction.size()) {
+        constructionIndex++;
+    } else if (++unit == operational[operationalIndex].count) {
+        operationalIndex++;
+        unit = 0;
+    }
+    return *this;
+}
+
+bool PlanFacilities::Iterator::operator==(const Iterator &other) const {
+    return constructionIndex == other.constructionIndex && operationalIndex == other.operationalIndex && unit == other.unit;
+}
+
+bool PlanFacilities::Iterator::operator!=(const Iterator &other) const {
+    return !(*this == other);
+}
+
+// ================== Plan ==================
 // Constructor
-Plan::Plan(const int planId, const Settlement *settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions)
-    : plan_id(planId), settlement(*settlement), selectionPolicy(selectionPolicy), facilityOptions(facilityOptions),
-      status(PlanStatus::AVAILABLE), life_quality_score(0), economy_score(0), environment_score(0)
+Plan::Plan(const int planId, const Settlement *settlement, SelectionPolicy *selectionPolicy)
+    : plan_id(planId), settlement(*settlement), selectionPolicy(selectionPolicy),
+      status(PlanStatus::AVAILABLE), underConstruction(),
+      operational(std::allocate_shared<OperationalRuns>(TrackingAllocator<OperationalRuns, MemorySubsystem::PLAN>())),
+      life_quality_score(0), economy_score(0), environment_score(0),
+      stochastic(), random(0), coldSegment{-1, 0, 0}, coldStore(nullptr)
       {
 
       }
 
+// Copy constructor, used when a forked simulation first changes a shared plan.
+// Only facilities under construction (at most 3) and the policy are deep copied,
+// the operational runs stay shared until either plan adds to them.
+Plan::Plan(const Plan &other)
+    : plan_id(other.plan_id), settlement(other.settlement), selectionPolicy(other.selectionPolicy->clone()),
+      status(other.status), underConstruction(), operational(other.operational),
+      life_quality_score(other.life_quality_score), economy_score(other.economy_score), environment_score(other.environment_score),
+      stochastic(other.stochastic), random(other.random),
+      coldSegment(other.coldSegment), coldStore(other.coldStore)
+{
+    for (const FacilityUnderConstruction &building : other.underConstruction) {
+        underConstruction.push_back(FacilityUnderConstruction{new Facility(*building.facility), building.typeIndex});
+    }
+}
+
+// Destructor
+Plan::~Plan()
+{
+    for (FacilityUnderConstruction &building : underConstruction) {
+        delete building.facility;
+    }
+    delete selectionPolicy;
+}
+
 // Getters for scores
 int const Plan::getlifeQualityScore() const
 {
@@ -27,23 +111,104 @@ int const Plan::getEnvironmentScore() const
     return environment_score;
 }
 
-// Setter for selection policy
+const Settlement &Plan::getSettlement() const
+{
+    return settlement;
+}
+
+PlanStatus Plan::getStatus() const
+{
+    return status;
+}
+
+int Plan::getUnderConstructionCount() const
+{
+    return underConstruction.size();
+}
+
+int Plan::getOperationalCount() const
+{
+    int total = isSpilled() ? coldSegment.facilityCount : 0;
+    for (const OperationalFacilities &run : *operational) {
+        total += run.count;
+    }
+    return total;
+}
+
+// Nothing under construction, so advancing would not change the plan
+bool Plan::isIdle() const
+{
+    return underConstruction.empty() && status == PlanStatus::AVAILABLE;
+}
+
+// Setter for selection policy, a policy that draws random numbers is seeded from the plan's stream
 void Plan::setSelectionPolicy(SelectionPolicy *selectionPolicy)
 {
+    delete this->selectionPolicy;
     this->selectionPolicy = selectionPolicy;
+    selectionPolicy->reseed(random.next());
+}
+
+// Restart the plan's random stream, the policy takes its seed from it
+void Plan::seed(uint64_t seed)
+{
+    random = RandomStream(seed);
+    selectionPolicy->reseed(random.next());
 }
 
-void Plan::step() {
-    // Step 1: Use the selection policy to select and add facilities
-    if (status == PlanStatus::AVAILABLE) {
-        const FacilityType &facilityType = selectionPolicy->selectFacility(facilityOptions);
-        Facility *newFacility = new Facility(facilityType, settlement.getName());
-        addFacility(newFacility); 
+// Draw construction times from the model, using this plan's own random stream
+void Plan::setStochastic(const std::shared_ptr<const StochasticModel> &model, uint64_t seed)
+{
+    stochastic = model;
+    this->seed(seed);
+}
+
+// A step is split in two stages, select (if available) then advance, which
+// Simulation::step runs for all plans at once so selections can be batched
+bool Plan::needsSelection() const
+{
+    return status == PlanStatus::AVAILABLE;
+}
+
+void Plan::select(const vector<FacilityType> &facilitiesOptions)
+{
+    const FacilityType *facilityType;
+    {
+        TRACE_SCOPE("SelectionPolicy::selectFacility");
+        facilityType = &selectionPolicy->selectFacility(facilitiesOptions);
     }
+    // Policies return one of the options, so its position is its catalog index
+    commitSelection(facilitiesOptions, facilityType - facilitiesOptions.data());
+}
+
+// Start building the option at typeIndex
+void Plan::commitSelection(const vector<FacilityType> &facilitiesOptions, int typeIndex)
+{
+    const FacilityType &facilityType = facilitiesOptions[typeIndex];
+    Facility *newFacility;
+    if (stochastic == nullptr) {
+        newFacility = new Facility(facilityType, settlement.getName());
+    } else {
+        int constructionTime = stochastic->drawDuration(facilityType.getCategory(), random);
+        newFacility = new Facility(facilityType, settlement.getName(), FacilityStatus::UNDER_CONSTRUCTIONS, constructionTime);
+    }
+    addFacility(newFacility, typeIndex);
+}
+
+SelectionPolicy &Plan::getSelectionPolicy()
+{
+    return *selectionPolicy;
+}
 
+// Progress construction and update the status, the second half of a step.
+// Returns how many facilities became operational.
+int Plan::advance()
+{
+    TRACE_SAMPLED_SCOPE("Plan::advance", 64);
+    int completed = 0;
     // Step 2: Update facilities' progress and status
-    for (int i = 0; i < underConstruction.size(); i++) {
-        Facility *facility = underConstruction[i];
+    for (int i = 0; i < (int)underConstruction.size();) {
+        Facility *facility = underConstruction[i].facility;
         FacilityStatus updatedStatus = facility->step();
     
         if (updatedStatus == FacilityStatus::OPERATIONAL) {
@@ -51,7 +216,14 @@ void Plan::step() {
             life_quality_score += facility->getLifeQualityScore();
             economy_score += facility->getEconomyScore();
             environment_score += facility->getEnvironmentScore();
+            // From here on the facility is only counted, not kept
+            addOperational(underConstruction[i].typeIndex);
+            delete facility;
             underConstruction.erase( std::next(underConstruction.begin(), i) );
+            completed++;
+        }
+        else {
+            i++;
         }
     }
 
@@ -68,25 +240,122 @@ void Plan::step() {
     {
         status = PlanStatus::AVAILABLE;
     }
+    return completed;
 }
 
 // this is a place holder, to be implemented with "PrintPlanStatus" base action
-void Plan::printStatus()
+void Plan::printStatus(const vector<FacilityType> &facilitiesOptions) const
 {
     cout << "Plan ID: " << plan_id << ", Status: ";
     cout << (status == PlanStatus::AVAILABLE ? "Available" : "Busy") << endl;
+    for (const Facility &facility : getFacilities(facilitiesOptions)) {
+        cout << facility.toString() << endl;
+    }
+}
+
+// Get the facilities, operational ones are expanded from their per-type counts.
+// facilitiesOptions is the catalog the plan was stepped on and must outlive the result.
+// The runs of a spilled plan are read into the result, the plan itself stays spilled and unchanged.
+PlanFacilities Plan::getFacilities(const vector<FacilityType> &facilitiesOptions) const
+{
+    if (!isSpilled()) {
+        return PlanFacilities(*this, facilitiesOptions, operational);
+    }
+    return PlanFacilities(*this, facilitiesOptions, readOperational());
+}
+
+// Whether spill() would move anything to the cold store
+bool Plan::canSpill() const
+{
+    return !isSpilled() && !operational->empty();
 }
 
-// Get the facilities
-const vector<Facility *> &Plan::getFacilities() const
+// Move the operational runs to the cold store. Stepping keeps working on a
+// spilled plan, facilities that become operational are kept in memory until
+// the spilled runs are faulted back in. Looking at the facilities reads them
+// without faulting them in.
+void Plan::spill(ColdStore &store)
 {
-    return facilities;
+    if (!canSpill()) {
+        return;
+    }
+    coldSegment = store.stage(*operational);
+    coldStore = &store;
+    operational = std::allocate_shared<OperationalRuns>(TrackingAllocator<OperationalRuns, MemorySubsystem::PLAN>());
+}
+
+bool Plan::isSpilled() const
+{
+    return coldSegment.offset >= 0;
+}
+
+// Keep the operational runs in memory again
+void Plan::faultIn()
+{
+    if (!isSpilled()) {
+        return;
+    }
+    operational = readOperational();
+    coldSegment = ColdSegment{-1, 0, 0};
+}
+
+// The spilled runs read back, in front of the ones added while spilled.
+// Uses pread only, so forks on other threads may call it on a shared plan.
+std::shared_ptr<OperationalRuns> Plan::readOperational() const
+{
+    TRACE_SCOPE("Plan::readOperational");
+    std::shared_ptr<OperationalRuns> runs = std::allocate_shared<OperationalRuns>(TrackingAllocator<OperationalRuns, MemorySubsystem::PLAN>());
+    coldStore->read(coldSegment, *runs);
+    for (const OperationalFacilities &added : *operational) {
+        bool merged = false;
+        for (OperationalFacilities &run : *runs) {
+            if (run.typeIndex == added.typeIndex) {
+                run.count += added.count;
+                merged = true;
+                break;
+            }
+        }
+        if (!merged) {
+            runs->push_back(added);
+        }
+    }
+    return runs;
+}
+
+// Add a facility to the plan, typeIndex is its type's position in the catalog
+void Plan::addFacility(Facility *facility, int typeIndex)
+{
+    if (facility->getStatus() == FacilityStatus::OPERATIONAL) {
+        addOperational(typeIndex);
+        delete facility;
+        return;
+    }
+    underConstruction.push_back(FacilityUnderConstruction{facility, typeIndex});
 }
 
-// Add a facility to the plan
-void Plan::addFacility(Facility *facility)
+// Count one more operational facility of this type
+void Plan::addOperational(int typeIndex)
 {
-    facilities.push_back(facility);
+    OperationalRuns &runs = ownOperational();
+    for (OperationalFacilities &run : runs) {
+        if (run.typeIndex == typeIndex) {
+            run.count++;
+            return;
+        }
+    }
+    runs.push_back(OperationalFacilities(typeIndex, 1));
+}
+
+// The runs for changing them, copied first if another plan still shares them
+OperationalRuns &Plan::ownOperational()
+{
+    if (operational.use_count() > 1) {
+        operational = std::allocate_shared<OperationalRuns>(TrackingAllocator<OperationalRuns, MemorySubsystem::PLAN>(), *operational);
+    } else {
+        // Sole owner: see the reads of a copy on another thread that let go of them
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return *operational;
 }
 
 // Convert the plan to string representation
@@ -0,0 +1,68 @@
+#include "PublishedState.h"
+#include "Simulation.h"
+#include <utility>
+
+PublishedState::PublishedState() : front(0) {
+    for (int i = 0; i < 2; i++) {
+        views[i].tick = 0;
+        readers[i] = 0;
+    }
+}
+
+// Pin the front view, then make sure it is still the front one: the writer only
+// checks the reader count of the back view, so a reader that raced with a flip
+// and pinned what became the back view backs off and tries again
+PublishedState::Reader::Reader(const PublishedState &state) : state(state), index(0) {
+    while (true) {
+        index = state.front.load();
+        state.readers[index].fetch_add(1);
+        if (state.front.load() == index) {
+            return;
+        }
+        state.readers[index].fetch_sub(1);
+    }
+}
+
+PublishedState::Reader::~Reader() {
+    state.readers[index].fetch_sub(1);
+}
+
+const PublishedView &PublishedState::Reader::view() const {
+    return state.views[index];
+}
+
+PublishedState::Reader PublishedState::read() const {
+    return Reader(*this);
+}
+
+// Returns false if a reader still held the back view and the tick was skipped
+bool PublishedState::publish(const Simulation &simulation) {
+    int back = 1 - front.load();
+    if (readers[back].load() != 0) {
+        return false;
+    }
+    PublishedView &view = views[back];
+    view.tick = simulation.getTick();
+    size_t count = 0;
+    for (int planId = 0; planId < simulation.getPlanCount(); planId++) {
+        if (!simulation.isPlanOwned(planId)) {
+            continue;
+        }
+        const Plan &plan = std::as_const(simulation).getPlan(planId);
+        if (count == view.plans.size()) {
+            view.plans.emplace_back();
+        }
+        PlanSummary &summary = view.plans[count++];
+        summary.planId = planId;
+        summary.status = plan.getStatus();
+        summary.lifeQualityScore = plan.getlifeQualityScore();
+        summary.economyScore = plan.getEconomyScore();
+        summary.environmentScore = plan.getEnvironmentScore();
+        summary.underConstructionCount = plan.getUnderConstructionCount();
+        summary.operationalCount = plan.getOperationalCount();
+        summary.settlementName = plan.getSettlement().getName();
+    }
+    view.plans.resize(count);
+    front.store(back);
+    return true;
+}
@@ -0,0 +1,137 @@
+#include "ScoreRecorder.h"
+#include <stdexcept>
+
+void ScoreBlock::clear() {
+    ticks.clear();
+    planIds.clear();
+    lifeQualityScores.clear();
+    economyScores.clear();
+    environmentScores.clear();
+}
+
+size_t ScoreBlock::size() const {
+    return ticks.size();
+}
+
+ScoreRecorder::ScoreRecorder(const string &path)
+    : output(path, std::ios::binary | std::ios::trunc), lastScores(), recorded(), filling(&blocks[0]), writing(nullptr), closing(false) {
+    if (!output) {
+        throw std::runtime_error("Cannot open score recording " + path);
+    }
+    for (ScoreBlock &block : blocks) {
+        block.ticks.reserve(blockRows);
+        block.planIds.reserve(blockRows);
+        block.lifeQualityScores.reserve(blockRows);
+        block.economyScores.reserve(blockRows);
+        block.environmentScores.reserve(blockRows);
+    }
+    writer = std::thread(&ScoreRecorder::writeBlocks, this);
+}
+
+// Hands over the last partial block and waits for everything to reach the file
+ScoreRecorder::~ScoreRecorder() {
+    if (filling->size() > 0) {
+        swapBlocks();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    writer.join();
+}
+
+void ScoreRecorder::record(long tick, int planId, int lifeQualityScore, int economyScore, int environmentScore) {
+    size_t slot = planId * 3;
+    if (static_cast<size_t>(planId) >= recorded.size()) {
+        lastScores.resize(slot + 3, 0);
+        recorded.resize(planId + 1, false);
+    }
+    if (recorded[planId] && lastScores[slot] == lifeQualityScore && lastScores[slot + 1] == economyScore && lastScores[slot + 2] == environmentScore) {
+        return;
+    }
+    recorded[planId] = true;
+    lastScores[slot] = lifeQualityScore;
+    lastScores[slot + 1] = economyScore;
+    lastScores[slot + 2] = environmentScore;
+
+    filling->ticks.push_back(tick);
+    filling->planIds.push_back(planId);
+    filling->lifeQualityScores.push_back(lifeQualityScore);
+    filling->economyScores.push_back(economyScore);
+    filling->environmentScores.push_back(environmentScore);
+    if (filling->size() == blockRows) {
+        swapBlocks();
+    }
+}
+
+void ScoreRecorder::swapBlocks() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return writing == nullptr; });
+    writing = filling;
+    filling = (filling == &blocks[0]) ? &blocks[1] : &blocks[0];
+    lock.unlock();
+    changed.notify_all();
+}
+
+template <typename T>
+static void writeColumn(std::ostream &output, const vector<T> &column) {
+    output.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T));
+}
+
+// Background thread: write each handed over block, then give it back
+void ScoreRecorder::writeBlocks() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this]() { return writing != nullptr || closing; });
+        if (writing == nullptr) {
+            return;
+        }
+        ScoreBlock *block = writing;
+        lock.unlock();
+
+        uint32_t header[2] = {magic, static_cast<uint32_t>(block->size())};
+        output.write(reinterpret_cast<const char*>(header), sizeof(header));
+        writeColumn(output, block->ticks);
+        writeColumn(output, block->planIds);
+        writeColumn(output, block->lifeQualityScores);
+        writeColumn(output, block->economyScores);
+        writeColumn(output, block->environmentScores);
+        output.flush();
+        block->clear();
+
+        lock.lock();
+        writing = nullptr;
+        changed.notify_all();
+    }
+}
+
+template <typename T>
+static bool readColumn(std::istream &input, vector<T> &column, size_t rows) {
+    column.resize(rows);
+    return bool(input.read(reinterpret_cast<char*>(column.data()), rows * sizeof(T)));
+}
+
+bool ScoreRecorder::convertToCsv(const string &binaryPath, const string &csvPath) {
+    std::ifstream input(binaryPath, std::ios::binary);
+    std::ofstream csv(csvPath);
+    if (!input || !csv) {
+        return false;
+    }
+    csv << "tick,plan_id,life_quality_score,economy_score,environment_score\n";
+    uint32_t header[2];
+    ScoreBlock block;
+    while (input.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        size_t rows = header[1];
+        if (header[0] != magic || !readColumn(input, block.ticks, rows) || !readColumn(input, block.planIds, rows)
+            || !readColumn(input, block.lifeQualityScores, rows) || !readColumn(input, block.economyScores, rows)
+            || !readColumn(input, block.environmentScores, rows)) {
+            return false;
+        }
+        for (size_t i = 0; i < rows; i++) {
+            csv << block.ticks[i] << "," << block.planIds[i] << "," << block.lifeQualityScores[i] << ","
+                << block.economyScores[i] << "," << block.environmentScores[i] << "\n";
+        }
+    }
+    return bool(csv);
+}
@@ -3,9 +3,33 @@
 #include <cmath>
 #include <algorithm>
 
+// ================== SelectionPolicy ==================
+void SelectionPolicy::reseed(uint64_t) {}
+
+SelectionPolicy *SelectionPolicy::restoreState(const PolicyState &state) {
+    SelectionPolicy *policy = nullptr;
+    if (state.kind == PolicyKind::NAIVE) {
+        policy = new NaiveSelection(state.values[0]);
+    } else if (state.kind == PolicyKind::BALANCED) {
+        policy = new BalancedSelection(state.values[0], state.values[1], state.values[2]);
+    } else if (state.kind == PolicyKind::ECONOMY) {
+        policy = new EconomySelection(state.values[0]);
+    } else if (state.kind == PolicyKind::SUSTAINABILITY) {
+        policy = new SustainabilitySelection(state.values[0]);
+    } else if (state.kind == PolicyKind::RANDOM) {
+        policy = new RandomSelection();
+        policy->reseed(state.random);
+    } else {
+        throw std::runtime_error("Unknown selection policy state");
+    }
+    return policy;
+}
+
 // ================== NaiveSelection ==================
 NaiveSelection::NaiveSelection() : lastSelectedIndex(-1) {}
 
+NaiveSelection::NaiveSelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex) {}
+
 const FacilityType& NaiveSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
     lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size();
     const FacilityType& selected = facilitiesOptions[lastSelectedIndex];
@@ -20,7 +44,14 @@ NaiveSelection* NaiveSelection::clone() const {
     return new NaiveSelection(*this);
 }
 
+PolicyState NaiveSelection::saveState() const {
+    return PolicyState{PolicyKind::NAIVE, {lastSelectedIndex, 0, 0}, 0};
+}
+
 // ================== BalancedSelection ==================
+BalancedSelection::BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore)
+    : LifeQualityScore(LifeQualityScore), EconomyScore(EconomyScore), EnvironmentScore(EnvironmentScore) {}
+
 const FacilityType& BalancedSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
 
     int minIndex = 0; // Index of the facility with the smallest imbalance
@@ -48,6 +79,50 @@ const FacilityType& BalancedSelection::selectFacility(const vector<FacilityType>
     return facilitiesOptions[minIndex];
 }
 
+// Cache-blocked (policies x catalog) sweep: the catalog is copied to plain
+// score arrays once, then each block of policies runs over one tile of it at a
+// time so the tile stays in L1. Tiles are visited in catalog order and only a
+// strictly smaller distance replaces the best, so ties go to the first facility
+// exactly like selectFacility.
+void BalancedSelection::selectBatch(const vector<BalancedSelection*> &policies, const vector<FacilityType> &facilitiesOptions, vector<int> &selected) {
+    const size_t policyBlock = 256;
+    const size_t catalogTile = 1024;
+    const size_t catalogSize = facilitiesOptions.size();
+    vector<int> lifeScores(catalogSize), econScores(catalogSize), envScores(catalogSize);
+    for (size_t i = 0; i < catalogSize; ++i) {
+        lifeScores[i] = facilitiesOptions[i].getLifeQualityScore();
+        econScores[i] = facilitiesOptions[i].getEconomyScore();
+        envScores[i] = facilitiesOptions[i].getEnvironmentScore();
+    }
+
+    selected.assign(policies.size(), 0);
+    vector<int> minDistances(policyBlock);
+    for (size_t first = 0; first < policies.size(); first += policyBlock) {
+        size_t count = std::min(policyBlock, policies.size() - first);
+        std::fill(minDistances.begin(), minDistances.begin() + count, std::numeric_limits<int>::max());
+        for (size_t tile = 0; tile < catalogSize; tile += catalogTile) {
+            size_t tileEnd = std::min(catalogSize, tile + catalogTile);
+            for (size_t p = 0; p < count; ++p) {
+                const BalancedSelection &policy = *policies[first + p];
+                int minDistance = minDistances[p];
+                int minIndex = selected[first + p];
+                for (size_t i = tile; i < tileEnd; ++i) {
+                    int lifeScore = policy.LifeQualityScore + lifeScores[i];
+                    int econScore = policy.EconomyScore + econScores[i];
+                    int envScore = policy.EnvironmentScore + envScores[i];
+                    int distance = std::max({lifeScore, econScore, envScore}) - std::min({lifeScore, econScore, envScore});
+                    if (distance < minDistance) {
+                        minDistance = distance;
+                        minIndex = i;
+                    }
+                }
+                minDistances[p] = minDistance;
+                selected[first + p] = minIndex;
+            }
+        }
+    }
+}
+
 const string BalancedSelection::toString() const {
     return "Balanced Selection Policy";
 }
@@ -56,9 +131,15 @@ BalancedSelection* BalancedSelection::clone() const {
     return new BalancedSelection(*this);
 }
 
+PolicyState BalancedSelection::saveState() const {
+    return PolicyState{PolicyKind::BALANCED, {LifeQualityScore, EconomyScore, EnvironmentScore}, 0};
+}
+
 // ================== EconomySelection ==================
 EconomySelection::EconomySelection() : lastSelectedIndex(-1) {}
 
+EconomySelection::EconomySelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex) {}
+
 const FacilityType& EconomySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
     int i = (lastSelectedIndex+ 1) % facilitiesOptions.size();
     while(i != lastSelectedIndex){
@@ -80,9 +161,15 @@ EconomySelection* EconomySelection::clone() const {
     return new EconomySelection(*this);
 }
 
+PolicyState EconomySelection::saveState() const {
+    return PolicyState{PolicyKind::ECONOMY, {lastSelectedIndex, 0, 0}, 0};
+}
+
 // ================== SustainabilitySelection ==================
 SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(-1) {}
 
+SustainabilitySelection::SustainabilitySelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex) {}
+
 const FacilityType& SustainabilitySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
     int i = (lastSelectedIndex+ 1) % facilitiesOptions.size();
     while(i != lastSelectedIndex){
@@ -102,4 +189,31 @@ const string SustainabilitySelection::toString() const {
 
 SustainabilitySelection* SustainabilitySelection::clone() const {
     return new SustainabilitySelection(*this);
-}
\ No newline at end of file
+}
+
+PolicyState SustainabilitySelection::saveState() const {
+    return PolicyState{PolicyKind::SUSTAINABILITY, {lastSelectedIndex, 0, 0}, 0};
+}
+
+// ================== RandomSelection ==================
+RandomSelection::RandomSelection() : random(0) {}
+
+const FacilityType& RandomSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+    return facilitiesOptions[random.nextInt(0, facilitiesOptions.size() - 1)];
+}
+
+const string RandomSelection::toString() const {
+    return "Random Selection Policy";
+}
+
+RandomSelection* RandomSelection::clone() const {
+    return new RandomSelection(*this);
+}
+
+void RandomSelection::reseed(uint64_t seed) {
+    random = RandomStream(seed);
+}
+
+PolicyState RandomSelection::saveState() const {
+    return PolicyState{PolicyKind::RANDOM, {0, 0, 0}, random.getState()};
+}
@@ -0,0 +1,269 @@
+#include "ShardCoordinator.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Auxiliary.h"
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+
+ShardCoordinator::ShardCoordinator(Simulation &simulation, int shardCount, const ShardFiles &files)
+    : simulation(simulation), shardCount(shardCount), workers() {
+    if (shardCount < 1) {
+        throw std::runtime_error("Shard count must be positive");
+    }
+    // A worker that died must show up as a failed write, not kill the coordinator with SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+    std::cout.flush();
+    for (int shardIndex = 0; shardIndex < shardCount; shardIndex++) {
+        int commands[2], replies[2];
+        if (pipe(commands) < 0 || pipe(replies) < 0) {
+            throw std::runtime_error("Cannot create shard pipes");
+        }
+        int pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("Cannot fork shard worker");
+        }
+        if (pid == 0) {
+            // The worker starts from a copy of the loaded simulation
+            for (ShardWorker &worker : workers) {
+                ::close(worker.commands);
+                fclose(worker.replies);
+            }
+            ::close(commands[1]);
+            ::close(replies[0]);
+            serveShard(shardIndex, commands[0], replies[1], files);
+        }
+        ::close(commands[0]);
+        ::close(replies[1]);
+        workers.push_back(ShardWorker{pid, commands[1], fdopen(replies[0], "r")});
+    }
+}
+
+ShardCoordinator::~ShardCoordinator() {
+    close();
+}
+
+// Worker side: read commands from the coordinator until "close", never returns
+void ShardCoordinator::serveShard(int shardIndex, int commands, int replies, const ShardFiles &files) {
+    simulation.setShard(shardIndex, shardCount);
+    if (!files.recordPath.empty()) {
+        simulation.startRecording(files.recordPath + "." + std::to_string(shardIndex));
+    }
+    if (!files.coldStorePath.empty()) {
+        simulation.enableColdStore(files.coldStorePath + "." + std::to_string(shardIndex), files.coldAfterTicks);
+    }
+    dup2(commands, STDIN_FILENO);
+    dup2(replies, STDOUT_FILENO);
+    ::close(commands);
+    ::close(replies);
+
+    string line;
+    while (std::getline(std::cin, line)) {
+        vector<string> arguments = Auxiliary::parseArguments(line);
+        if (arguments.empty()) {
+            continue;
+        }
+        if (arguments[0] == "close") {
+            break;
+        }
+        BaseAction *action = Simulation::parseAction(arguments);
+        if (action == nullptr) {
+            std::cout << "Error: Unknown command\nERROR" << std::endl;
+            continue;
+        }
+        action->act(simulation);
+        simulation.addAction(action);
+        std::cout << (action->getStatus() == ActionStatus::COMPLETED ? "COMPLETED" : "ERROR") << std::endl;
+    }
+    simulation.stopRecording();
+    std::cout.flush();
+    _exit(0);
+}
+
+void ShardCoordinator::send(ShardWorker &worker, const string &line) {
+    string message = line + "\n";
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t written = ::write(worker.commands, message.data() + sent, message.size() - sent);
+        if (written <= 0) {
+            throw std::runtime_error("Shard worker is gone");
+        }
+        sent += written;
+    }
+}
+
+// Read one reply, up to and including its status line
+string ShardCoordinator::receive(ShardWorker &worker) {
+    string reply;
+    char *buffer = nullptr;
+    size_t capacity = 0;
+    while (getline(&buffer, &capacity, worker.replies) > 0) {
+        string line(buffer);
+        reply += line;
+        if (line == "COMPLETED\n" || line == "ERROR\n") {
+            free(buffer);
+            return reply;
+        }
+    }
+    free(buffer);
+    throw std::runtime_error("Shard worker is gone");
+}
+
+// Every shard executes the command in parallel. Identical replies are
+// reported once, otherwise each shard's output is listed separately.
+string ShardCoordinator::broadcast(const string &line) {
+    for (ShardWorker &worker : workers) {
+        send(worker, line);
+    }
+    vector<string> replies;
+    bool identical = true;
+    bool failed = false;
+    for (ShardWorker &worker : workers) {
+        replies.push_back(receive(worker));
+        identical = identical && replies.back() == replies.front();
+        failed = failed || replies.back().compare(replies.back().size() - 6, 6, "ERROR\n") == 0;
+    }
+    if (identical) {
+        return replies.front();
+    }
+    std::stringstream ss;
+    for (int shardIndex = 0; shardIndex < shardCount; shardIndex++) {
+        const string &reply = replies[shardIndex];
+        ss << "Shard " << shardIndex << ":\n" << reply.substr(0, reply.rfind('\n', reply.size() - 2) + 1);
+    }
+    ss << (failed ? "ERROR" : "COMPLETED") << "\n";
+    return ss.str();
+}
+
+// Commands about one plan go to the shard stepping it
+string ShardCoordinator::sendToOwner(int planId, const string &line) {
+    if (planId < 0 || planId >= simulation.getPlanCount()) {
+        return "Error: Plan does not exist\nERROR\n";
+    }
+    const Plan &plan = std::as_const(simulation).getPlan(planId);
+    ShardWorker &owner = workers[Simulation::getSettlementShard(plan.getSettlement().getName(), shardCount)];
+    send(owner, line);
+    return receive(owner);
+}
+
+// Gather every shard's plan scores and list them by plan ID, like a single process would
+string ShardCoordinator::aggregateScores() {
+    for (ShardWorker &worker : workers) {
+        send(worker, "scores");
+    }
+    std::map<int, string> scores;
+    for (ShardWorker &worker : workers) {
+        std::istringstream reply(receive(worker));
+        string line;
+        while (std::getline(reply, line) && line != "COMPLETED" && line != "ERROR") {
+            scores[std::stoi(line)] = line;
+        }
+    }
+    std::stringstream ss;
+    for (const std::pair<const int, string> &score : scores) {
+        ss << score.second << "\n";
+    }
+    ss << "COMPLETED\n";
+    return ss.str();
+}
+
+// Every shard runs the same forks but only reports its own plans: list the
+// plans by ID under the common header and add up the shards' throughput
+string ShardCoordinator::aggregateMonteCarlo(const string &line) {
+    for (ShardWorker &worker : workers) {
+        send(worker, line);
+    }
+    vector<string> replies;
+    for (ShardWorker &worker : workers) {
+        replies.push_back(receive(worker));
+    }
+    string header;
+    std::map<int, string> plans;
+    double planTicksPerSecond = 0;
+    for (const string &reply : replies) {
+        if (reply.compare(reply.size() - 6, 6, "ERROR\n") == 0) {
+            return reply;
+        }
+        std::istringstream lines(reply);
+        string planLine;
+        std::getline(lines, header);
+        while (std::getline(lines, planLine) && planLine != "COMPLETED") {
+            if (planLine.compare(0, 8, "PlanID: ") == 0) {
+                string block = planLine + "\n", scoreLine;
+                for (int i = 0; i < 3 && std::getline(lines, scoreLine); i++) {
+                    block += scoreLine + "\n";
+                }
+                plans[std::stoi(planLine.substr(8))] = block;
+            } else if (planLine.compare(0, 12, "Throughput: ") == 0) {
+                planTicksPerSecond += std::stod(planLine.substr(12));
+            }
+        }
+    }
+    std::stringstream ss;
+    ss << header << "\n";
+    for (const std::pair<const int, string> &plan : plans) {
+        ss << plan.second;
+    }
+    ss << "Throughput: " << static_cast<long>(planTicksPerSecond) << " plan-ticks/s\n";
+    ss << "COMPLETED\n";
+    return ss.str();
+}
+
+string ShardCoordinator::execute(const string &line) {
+    vector<string> arguments = Auxiliary::parseArguments(line);
+    if (arguments.empty()) {
+        return "";
+    }
+    if (arguments[0] == "close") {
+        close();
+        return "COMPLETED\n";
+    }
+    BaseAction *action = Simulation::parseAction(arguments);
+    if (action == nullptr) {
+        return "Error: Unknown command\nERROR\n";
+    }
+
+    if (arguments[0] == "planStatus" || arguments[0] == "whatif") {
+        // Only the owning shard has the plan's facilities and scores
+        delete action;
+        return sendToOwner(std::stoi(arguments[1]), line);
+    }
+    if (arguments[0] == "scores") {
+        delete action;
+        return aggregateScores();
+    }
+    if (arguments[0] == "montecarlo") {
+        delete action;
+        return aggregateMonteCarlo(line);
+    }
+    if (!action->isReadOnly() && arguments[0] != "step") {
+        // Keep the local registries in sync so later commands can be routed
+        std::stringstream discarded;
+        std::streambuf *console = std::cout.rdbuf(discarded.rdbuf());
+        action->act(simulation);
+        std::cout.rdbuf(console);
+        simulation.addAction(action);
+    } else {
+        delete action;
+    }
+    return broadcast(line);
+}
+
+void ShardCoordinator::close() {
+    for (ShardWorker &worker : workers) {
+        try {
+            send(worker, "close");
+        } catch (const std::exception &e) {
+            // Already exited, nothing left to tell it
+        }
+        ::close(worker.commands);
+        fclose(worker.replies);
+        waitpid(worker.pid, nullptr, 0);
+    }
+    workers.clear();
+}
@@ -4,16 +4,21 @@
 #include "Facility.h"
 #include "Plan.h"
 #include "Action.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "EmbeddedCatalog.h"
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
 #include <iostream>
 
 // Constructor
-Simulation::Simulation(const string &configFilePath) : isRunning(false), planCounter(0) {
+Simulation::Simulation(const string &configFilePath) : isRunning(false), planCounter(0), tickCounter(0), shardIndex(0), shardCount(1), stochasticSeed(0), isPublishing(true), coldAfterTicks(0), imageEveryTicks(0) {
+    TRACE_SCOPE("Simulation::loadConfig");
     // Open the configuration file
     std::ifstream configFile(configFilePath);
 
+    vector<FacilityType> facilities; //Published together once the whole file is read
     std::string line;
     while (std::getline(configFile, line)) {
         std::istringstream iss(line);
@@ -35,10 +40,7 @@ Simulation::Simulation(const string &configFilePath) : isRunning(false), planCou
             int category, price, lifeQualityImpact, economyImpact, environmentImpact;
             iss >> name >> category >> price >> lifeQualityImpact >> economyImpact >> environmentImpact;
 
-            FacilityType facility(name, static_cast<FacilityCategory>(category), price, lifeQualityImpact, economyImpact, environmentImpact);
-            if (!addFacility(facility)) {
-                throw std::runtime_error("Duplicate facility in config file");
-            }
+            facilities.push_back(FacilityType(name, static_cast<FacilityCategory>(category), price, lifeQualityImpact, economyImpact, environmentImpact));
         } else if (command == "plan") {
             std::string settlementName, policyType;
             iss >> settlementName >> policyType;
@@ -52,6 +54,8 @@ Simulation::Simulation(const string &configFilePath) : isRunning(false), planCou
                 policy = new EconomySelection();
             } else if (policyType == "env") {
                 policy = new SustainabilitySelection();
+            } else if (policyType == "rnd") {
+                policy = new RandomSelection();
             } else {
                 throw std::runtime_error("Unknown selection policy type in config file");
             }
@@ -63,23 +67,150 @@ Simulation::Simulation(const string &configFilePath) : isRunning(false), planCou
                 delete policy; // Clean up if the settlement doesn't exist
                 throw std::runtime_error("Error creating plan: " + std::string(e.what()));
             }
+        } else if (command == "duration") {
+            int category, minimum, maximum;
+            iss >> category >> minimum >> maximum;
+            setConstructionDuration(static_cast<FacilityCategory>(category), minimum, maximum);
         } else {
             throw std::runtime_error("Invalid command in config file: " + command);
         }
     }
+    if (!addFacilities(facilities)) {
+        throw std::runtime_error("Duplicate facility in config file");
+    }
+}
+
+// Constructor from the config embedded by the build (see scripts/embed_config.awk):
+// no parsing, and plans get policies specialized for the compiled catalog
+Simulation::Simulation(EmbeddedConfig) : isRunning(false), planCounter(0), tickCounter(0), shardIndex(0), shardCount(1), stochasticSeed(0), isPublishing(true), coldAfterTicks(0), imageEveryTicks(0) {
+    TRACE_SCOPE("Simulation::loadEmbeddedConfig");
+    for (const SettlementEntry &entry : embeddedSettlements) {
+        Settlement *newSettlement = new Settlement(entry.name, entry.type);
+        if (!addSettlement(newSettlement)) {
+            throw std::runtime_error("Duplicate settlement in embedded config");
+        }
+    }
+    // The whole compiled table becomes the first catalog version
+    vector<FacilityType> facilities;
+    facilities.reserve(embeddedFacilities.size());
+    for (const CatalogEntry &entry : embeddedFacilities) {
+        facilities.push_back(FacilityType(entry.name, entry.category, entry.price, entry.lifeQualityScore, entry.economyScore, entry.environmentScore));
+    }
+    if (!addFacilities(facilities)) {
+        throw std::runtime_error("Duplicate facility in embedded config");
+    }
+    for (const PlanEntry &entry : embeddedPlans) {
+        const string policyType = entry.selectionPolicy;
+        SelectionPolicy *policy = nullptr;
+        if (policyType == "nve") {
+            policy = new NaiveSelection();
+        } else if (policyType == "bal") {
+            policy = new CompiledBalancedSelection<embeddedFacilities>(0, 0, 0);
+        } else if (policyType == "eco") {
+            policy = new CompiledCategorySelection<embeddedFacilities, FacilityCategory::ECONOMY>();
+        } else if (policyType == "env") {
+            policy = new CompiledCategorySelection<embeddedFacilities, FacilityCategory::ENVIRONMENT>();
+        } else if (policyType == "rnd") {
+            policy = new RandomSelection();
+        } else {
+            throw std::runtime_error("Unknown selection policy type in embedded config");
+        }
+        addPlan(getSettlement(entry.settlementName), policy);
+    }
+    for (const DurationEntry &entry : embeddedDurations) {
+        setConstructionDuration(entry.category, entry.minimum, entry.maximum);
+    }
+}
+
+// Forks share plans, settlements and the catalog version with the simulation
+// they came from, see fork()
+Simulation::Simulation(const Simulation &other)
+    : isRunning(other.isRunning), planCounter(other.planCounter), tickCounter(other.tickCounter),
+      shardIndex(other.shardIndex), shardCount(other.shardCount), ownedPlans(other.ownedPlans), changedPlans(other.changedPlans), scoreRecorder(),
+      actionsLog(), plans(other.plans), settlements(other.settlements), facilitiesOptions(other.facilitiesOptions),
+      durationModel(other.durationModel), stochasticModel(other.stochasticModel), stochasticSeed(other.stochasticSeed),
+      publishedState(), isPublishing(false), coldStore(), coldAfterTicks(other.coldAfterTicks),
+      batchPlans(), batchPolicies(), batchSelections(), image(), imageEveryTicks(0),
+      scheduler(other.scheduler != nullptr ? new ConstructionScheduler(*other.scheduler) : nullptr), admittedPlans() {}
+
+// Empty simulation for SimulationImage::restore to fill
+Simulation::Simulation() : isRunning(false), planCounter(0), tickCounter(0), shardIndex(0), shardCount(1), stochasticSeed(0),
+      isPublishing(true), coldAfterTicks(0), imageEveryTicks(0) {}
+
+// Destructor
+Simulation::~Simulation() {
+    for (BaseAction *action : actionsLog) {
+        delete action;
+    }
+}
+
+// Cheap what-if copy: plans are shared and only copied the first time either
+// side changes them, so a fork costs one pointer per plan plus what it touches.
+// The fork starts with an empty action log, no score recording, does not
+// publish its state and does not spill plans (it can still fault them in). A simulation must not be stepped while it is being forked.
+std::unique_ptr<Simulation> Simulation::fork() const {
+    return std::unique_ptr<Simulation>(new Simulation(*this));
+}
+
+// The simulation as of the last checkpoint in the image, nullptr if it has none.
+// It keeps checkpointing into the image every everyTicks ticks.
+std::unique_ptr<Simulation> Simulation::openImage(const string &imagePath, int everyTicks) {
+    if (everyTicks < 1) {
+        throw std::runtime_error("Invalid image checkpoint interval");
+    }
+    std::unique_ptr<SimulationImage> existing(new SimulationImage(imagePath));
+    if (!existing->hasCheckpoint()) {
+        return nullptr;
+    }
+    std::unique_ptr<Simulation> simulation(new Simulation());
+    existing->restore(*simulation);
+    simulation->image = std::move(existing);
+    simulation->imageEveryTicks = everyTicks;
+    return simulation;
+}
+
+// Checkpoint all of the simulation into the image now, then what changed every everyTicks ticks
+void Simulation::attachImage(const string &imagePath, int everyTicks) {
+    if (everyTicks < 1) {
+        throw std::runtime_error("Invalid image checkpoint interval");
+    }
+    image.reset(new SimulationImage(imagePath));
+    imageEveryTicks = everyTicks;
+    changedPlans.assign(plans.size(), true);
+    checkpoint();
+}
+
+// Changes made since the last tick boundary, such as new plans, are only kept once checkpointed
+void Simulation::checkpoint() {
+    if (image != nullptr) {
+        image->checkpoint(*this);
+    }
 }
 
 // Start the simulation
 void Simulation::start() {
     isRunning = true;
+    if (isPublishing) {
+        publishedState.publish(*this);
+    }
     std::cout << "The simulation has started" << std::endl;
 }
 
 // Add a plan
 void Simulation::addPlan(const Settlement *settlement, SelectionPolicy *selectionPolicy) {
-Plan newPlan(planCounter, settlement, selectionPolicy, facilitiesOptions);
+plans.push_back(std::allocate_shared<Plan>(TrackingAllocator<Plan, MemorySubsystem::PLAN>(), planCounter, settlement, selectionPolicy));
+// Seeded from (seed, plan ID) in deterministic mode too, so "rnd" plans do not all pick alike
+if (stochasticModel != nullptr) {
+    plans.back()->setStochastic(stochasticModel, RandomStream::mix(stochasticSeed, planCounter));
+} else {
+    plans.back()->seed(RandomStream::mix(stochasticSeed, planCounter));
+}
+ownedPlans.push_back(getSettlementShard(settlement->getName(), shardCount) == shardIndex);
+changedPlans.push_back(true);
+if (scheduler != nullptr && ownedPlans.back()) {
+    scheduler->enqueue(planCounter, *settlement, 0);
+}
 planCounter++;
-plans.push_back(newPlan);
     
 }
 
@@ -95,25 +226,28 @@ bool Simulation::addSettlement(Settlement *settlement) {
         std::cout << "Settlement already exists." << std::endl;
         return false;
     }
-    settlements.push_back(settlement);
+    settlements.push_back(shared_ptr<Settlement>(settlement));
     return true;
 }
 
 // Add a facility type
 bool Simulation::addFacility(FacilityType facility) {
-    for (const FacilityType &existingFacility : facilitiesOptions) {
-        if (existingFacility.getName() == facility.getName()) {
-            std::cout << "Facility already exists." << std::endl;
-            return false; // Duplicate facility found
-        }
+    // Publishes a new catalog version, plans keep stepping on the version they pinned
+    if (!facilitiesOptions.addFacility(facility)) {
+        std::cout << "Facility already exists." << std::endl;
+        return false; // Duplicate facility found
     }
-    facilitiesOptions.push_back(facility); // Add the facility if no duplicates
     return true;
 }
 
+// Add several facility types as one catalog version, false (and nothing added) on a duplicate
+bool Simulation::addFacilities(const vector<FacilityType> &facilities) {
+    return facilitiesOptions.addFacilities(facilities);
+}
+
 // Check if a settlement exists
 bool Simulation::isSettlementExists(const string &settlementName) {
-    for (const Settlement *settlement : settlements) { 
+    for (const shared_ptr<Settlement> &settlement : settlements) { 
         if (settlement->getName() == settlementName) { 
             return true;
         }
@@ -123,27 +257,290 @@ bool Simulation::isSettlementExists(const string &settlementName) {
 
 // Get a settlement by name
 Settlement *Simulation::getSettlement(const string &settlementName) {
-    for (Settlement *settlement : settlements) { 
+    for (const shared_ptr<Settlement> &settlement : settlements) { 
         if (settlement->getName() == settlementName) { 
-            return settlement; 
+            return settlement.get(); 
         }
     }
     throw std::runtime_error("Settlement not found"); 
 }
 
-// Get a plan by Id
+// Plans refer to facility types by their index in this catalog
+const FacilityCatalog &Simulation::getFacilityCatalog() const {
+    return facilitiesOptions;
+}
+
+// Get a plan by Id, for changing it
 Plan &Simulation::getPlan(const int planId) {
-    if (planId>= planCounter)
+    if (planId < 0 || planId>= planCounter)
         throw std::runtime_error("Plan not found");
     else
-         return plans[planId];   
+         return unsharePlan(planId);   
+}
+
+// Get a plan by Id, read only
+const Plan &Simulation::getPlan(const int planId) const {
+    if (planId < 0 || planId>= planCounter)
+        throw std::runtime_error("Plan not found");
+    else
+         return *plans[planId];   
+}
+
+// Copy a plan still shared with a fork before it gets changed, the next checkpoint rewrites it
+Plan &Simulation::unsharePlan(int planId) {
+    changedPlans[planId] = true;
+    if (plans[planId].use_count() > 1) {
+        plans[planId] = std::allocate_shared<Plan>(TrackingAllocator<Plan, MemorySubsystem::PLAN>(), *plans[planId]);
+    }
+    return *plans[planId];
 }
 
 // Perform a simulation step
 void Simulation::step() {
-    for (Plan &plan : plans) {
-        plan.step();
+    TRACE_SCOPE("Simulation::step");
+    PerfScope tickCounters(PerfRegion::TICK, 0);
+    // Pin the catalog so a concurrent AddFacility cannot pull it from under the policies
+    shared_ptr<const FacilityCatalog::Snapshot> catalog = facilitiesOptions.pin();
+    const vector<FacilityType> &options = catalog->getOptions();
+
+    // Selection stage: balanced plans are picked for together, the rest one by one.
+    // With shared capacity only the plans the scheduler admits pick.
+    // Its counters are read once around the whole stage, not per plan.
+    {
+        PerfScope selectionCounters(PerfRegion::SELECTION, 0);
+        long selected = 0;
+        batchPlans.clear();
+        batchPolicies.clear();
+        // Plans still shared with a fork are only copied once they are about to change.
+        if (scheduler != nullptr) {
+            scheduler->admit(admittedPlans);
+            for (int planId : admittedPlans) {
+                if (plans[planId]->needsSelection()) {
+                    queueSelection(unsharePlan(planId), options);
+                    selected++;
+                } else {
+                    scheduler->release(plans[planId]->getSettlement(), 1);
+                }
+            }
+        } else {
+            for (size_t i = 0; i < plans.size(); i++) {
+                if (ownedPlans[i] && plans[i]->needsSelection()) {
+                    queueSelection(unsharePlan(i), options);
+                    selected++;
+                }
+            }
+        }
+        if (!batchPlans.empty()) {
+            TRACE_SCOPE("BalancedSelection::selectBatch");
+            BalancedSelection::selectBatch(batchPolicies, options, batchSelections);
+        }
+        for (size_t i = 0; i < batchPlans.size(); i++) {
+            batchPlans[i]->commitSelection(options, batchSelections[i]);
+        }
+        selectionCounters.setPlanTicks(selected);
+    }
+
+    // Construction stage
+    long stepped = 0;
+    for (size_t i = 0; i < plans.size(); i++) {
+        if (ownedPlans[i]) {
+            stepped++;
+            if (plans[i]->isIdle()) {
+                continue;
+            }
+            Plan &plan = unsharePlan(i);
+            int completed = plan.advance();
+            if (scheduler != nullptr) {
+                if (completed > 0) {
+                    scheduler->release(plan.getSettlement(), completed);
+                }
+                if (plan.needsSelection()) {
+                    scheduler->enqueue(i, plan.getSettlement(), getTotalScore(plan));
+                }
+            }
+        }
+    }
+    tickCounters.setPlanTicks(stepped);
+    tickCounter++;
+    if (scoreRecorder != nullptr) {
+        for (size_t i = 0; i < plans.size(); i++) {
+            if (ownedPlans[i]) {
+                const Plan &plan = *plans[i];
+                scoreRecorder->record(tickCounter, i, plan.getlifeQualityScore(), plan.getEconomyScore(), plan.getEnvironmentScore());
+            }
+        }
+    }
+    if (coldStore != nullptr && tickCounter % coldAfterTicks == 0) {
+        spillIdlePlans();
+    }
+    if (image != nullptr && tickCounter % imageEveryTicks == 0) {
+        image->checkpoint(*this);
+    }
+    if (isPublishing) {
+        publishedState.publish(*this);
+    }
+}
+
+void Simulation::queueSelection(Plan &plan, const vector<FacilityType> &options) {
+    BalancedSelection *balanced = dynamic_cast<BalancedSelection*>(&plan.getSelectionPolicy());
+    if (balanced != nullptr) {
+        batchPlans.push_back(&plan);
+        batchPolicies.push_back(balanced);
+    } else {
+        plan.select(options);
+    }
+}
+
+// What the scheduler ranks plans by, lowest first
+int Simulation::getTotalScore(const Plan &plan) {
+    return plan.getlifeQualityScore() + plan.getEconomyScore() + plan.getEnvironmentScore();
+}
+
+// Plans leave their operational runs on disk, queries read them from there.
+// Only plans that spill are unshared, and the sweep is appended with one write.
+void Simulation::spillIdlePlans() {
+    TRACE_SCOPE("Simulation::spillIdlePlans");
+    for (size_t i = 0; i < plans.size(); i++) {
+        if (ownedPlans[i] && plans[i]->canSpill()) {
+            unsharePlan(i).spill(*coldStore);
+        }
+    }
+    coldStore->flush();
+}
+
+// Build the action matching a console command, nullptr if the command is not recognized
+BaseAction *Simulation::parseAction(const vector<string> &arguments) {
+    try {
+        const string &command = arguments.at(0);
+        if (command == "step" && arguments.size() == 2) {
+            return new SimulateStep(std::stoi(arguments[1]));
+        } else if (command == "plan" && arguments.size() == 3) {
+            return new AddPlan(arguments[1], arguments[2]);
+        } else if (command == "settlement" && arguments.size() == 3) {
+            return new AddSettlement(arguments[1], static_cast<SettlementType>(std::stoi(arguments[2])));
+        } else if (command == "facility" && arguments.size() == 7) {
+            return new AddFacility(arguments[1], static_cast<FacilityCategory>(std::stoi(arguments[2])), std::stoi(arguments[3]),
+                                   std::stoi(arguments[4]), std::stoi(arguments[5]), std::stoi(arguments[6]));
+        } else if (command == "planStatus" && arguments.size() == 2) {
+            return new PrintPlanStatus(std::stoi(arguments[1]));
+        } else if (command == "changePolicy" && arguments.size() == 3) {
+            return new ChangePlanPolicy(std::stoi(arguments[1]), arguments[2]);
+        } else if (command == "whatif" && arguments.size() == 3) {
+            return new EvaluatePolicies(std::stoi(arguments[1]), std::stoi(arguments[2]));
+        } else if (command == "scores" && arguments.size() == 1) {
+            return new PrintPlanScores();
+        } else if (command == "memory" && arguments.size() == 1) {
+            return new PrintMemoryUsage();
+        } else if (command == "trace" && arguments.size() == 2) {
+            return new ExportTrace(arguments[1]);
+        } else if (command == "duration" && arguments.size() == 4) {
+            return new SetConstructionDuration(static_cast<FacilityCategory>(std::stoi(arguments[1])), std::stoi(arguments[2]), std::stoi(arguments[3]));
+        } else if (command == "stochastic" && arguments.size() == 2) {
+            return new EnableStochastic(std::stoull(arguments[1]));
+        } else if (command == "perf" && (arguments.size() == 1 || (arguments.size() == 2 && arguments[1] == "reset"))) {
+            return new PrintPerfCounters(arguments.size() == 2);
+        } else if (command == "montecarlo" && arguments.size() == 4) {
+            return new RunMonteCarlo(std::stoi(arguments[1]), std::stoi(arguments[2]), std::stoull(arguments[3]));
+        }
+    } catch (const std::exception &e) {
+        // Malformed number or missing argument
+    }
+    return nullptr;
+}
+
+long Simulation::getTick() const {
+    return tickCounter;
+}
+
+// Record every plan's scores after each step, see ScoreRecorder for the format
+void Simulation::startRecording(const string &path) {
+    scoreRecorder.reset(new ScoreRecorder(path));
+}
+
+// Flushes what was recorded so far
+void Simulation::stopRecording() {
+    scoreRecorder.reset();
+}
+
+// Restrict stepping to the plans whose settlement falls in the given shard
+void Simulation::setShard(int shardIndex, int shardCount) {
+    this->shardIndex = shardIndex;
+    this->shardCount = shardCount;
+    for (size_t i = 0; i < plans.size(); i++) {
+        ownedPlans[i] = getSettlementShard(plans[i]->getSettlement().getName(), shardCount) == shardIndex;
+    }
+    if (scheduler != nullptr) {
+        enableSharedCapacity();
+    }
+}
+
+// Construction capacity is shared by all plans of a settlement instead of
+// each plan having the full capacity to itself, see ConstructionScheduler
+void Simulation::enableSharedCapacity() {
+    scheduler.reset(new ConstructionScheduler());
+    for (size_t i = 0; i < plans.size(); i++) {
+        if (ownedPlans[i]) {
+            const Plan &plan = *plans[i];
+            scheduler->build(plan.getSettlement(), plan.getUnderConstructionCount());
+            if (plan.needsSelection()) {
+                scheduler->enqueue(i, plan.getSettlement(), getTotalScore(plan));
+            }
+        }
+    }
+}
+
+bool Simulation::isPlanOwned(const int planId) const {
+    return planId >= 0 && planId < planCounter && ownedPlans[planId];
+}
+
+int Simulation::getPlanCount() const {
+    return planCounter;
+}
+
+// Takes effect on plans immediately if stochastic mode is already on, restarting their random streams
+void Simulation::setConstructionDuration(FacilityCategory category, int minimum, int maximum) {
+    durationModel.setDuration(category, minimum, maximum);
+    if (stochasticModel != nullptr) {
+        enableStochastic(stochasticSeed);
+    }
+}
+
+// Every plan draws from its own stream derived from (seed, plan ID), so a run
+// only depends on the seed and not on which thread or process steps the plan
+void Simulation::enableStochastic(uint64_t seed) {
+    stochasticModel = std::make_shared<const StochasticModel>(durationModel);
+    stochasticSeed = seed;
+    for (size_t i = 0; i < plans.size(); i++) {
+        unsharePlan(i).setStochastic(stochasticModel, RandomStream::mix(seed, i));
+    }
+}
+
+const StochasticModel &Simulation::getConstructionDurations() const {
+    return durationModel;
+}
+
+// Readers on other threads pin a view with getPublishedState().read(). Plans
+// added since the last tick show up once the next tick is published.
+const PublishedState &Simulation::getPublishedState() const {
+    return publishedState;
+}
+
+// Every idleTicks ticks, spill the operational facilities plans keep in memory to a segment file
+void Simulation::enableColdStore(const string &path, int idleTicks) {
+    if (idleTicks < 1) {
+        throw std::runtime_error("Invalid cold store idle ticks");
+    }
+    coldStore.reset(new ColdStore(path));
+    coldAfterTicks = idleTicks;
+}
+
+// FNV-1a, so every process maps a settlement to the same shard
+int Simulation::getSettlementShard(const string &settlementName, int shardCount) {
+    unsigned long hash = 14695981039346656037UL;
+    for (char c : settlementName) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211UL;
     }
+    return hash % shardCount;
 }
 
 // Close the simulation
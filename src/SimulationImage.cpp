@@ -0,0 +1,447 @@
+#include "SimulationImage.h"
+#include "Simulation.h"
+#include "Plan.h"
+#include "SelectionPolicy.h"
+#include "Trace.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+const uint32_t imageMagic = 0x53494d47;
+const uint32_t imageFormatVersion = 2;
+const size_t headerSize = 4096; //The header has a page of its own so committing it is one msync
+const size_t maxConstructions = 3; //A metropolis builds at most 3 facilities at once
+
+struct SettlementRecord {
+    uint32_t name; //Offset into the name bytes of the tables
+    uint32_t nameLength;
+    int32_t type;
+};
+
+struct FacilityTypeRecord {
+    uint32_t name;
+    uint32_t nameLength;
+    int32_t category;
+    int32_t price;
+    int32_t lifeQualityScore;
+    int32_t economyScore;
+    int32_t environmentScore;
+};
+
+struct ConstructionRecord {
+    int32_t facilityType; //Index into the facility type records
+    int32_t timeLeft;
+};
+
+struct RunRecord {
+    int32_t facilityType;
+    int32_t count;
+};
+
+struct PlanRecord {
+    uint64_t generation; //Checkpoint that wrote this copy, 0 if none did
+    int32_t settlement; //Index into the settlement records
+    int32_t status;
+    int32_t lifeQualityScore;
+    int32_t economyScore;
+    int32_t environmentScore;
+    int32_t constructionCount;
+    ConstructionRecord constructions[maxConstructions];
+    uint64_t runs; //Offset of this copy's own run extent
+    uint32_t runCapacity;
+    uint32_t runCount;
+    PolicyState policy;
+    uint64_t random;
+};
+
+struct PlanSlot {
+    PlanRecord copies[2];
+};
+
+// Tables layout: the settlement records, the facility type records, then the name bytes
+struct TablesLayout {
+    TablesLayout(size_t settlementCount, size_t facilityTypeCount, size_t nameBytes) {
+        facilityTypes = align(settlementCount * sizeof(SettlementRecord));
+        names = align(facilityTypes + facilityTypeCount * sizeof(FacilityTypeRecord));
+        size = names + nameBytes;
+    }
+    static size_t align(size_t offset) {
+        return (offset + 7) & ~static_cast<size_t>(7);
+    }
+    size_t facilityTypes, names, size;
+};
+
+uint64_t checksum(const char *data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t rootChecksum(const ImageRoot &root) {
+    return checksum(reinterpret_cast<const char*>(&root), offsetof(ImageRoot, checksum));
+}
+
+// The copy of a plan's record that belongs to the checkpoint of this generation, -1 if none does
+int currentCopy(const PlanSlot &slot, uint64_t generation) {
+    int current = -1;
+    for (int i = 0; i < 2; i++) {
+        uint64_t written = slot.copies[i].generation;
+        if (written != 0 && written <= generation && (current < 0 || written > slot.copies[current].generation)) {
+            current = i;
+        }
+    }
+    return current;
+}
+
+size_t pageAlign(size_t offset) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    return (offset + page - 1) / page * page;
+}
+
+}
+
+SimulationImage::SimulationImage(const string &path) : fd(-1), base(nullptr), mappedSize(0), inSync(false), settlementIndices() {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open simulation image " + path);
+    }
+    struct stat status;
+    fstat(fd, &status);
+    bool created = status.st_size == 0;
+    if (created && ftruncate(fd, headerSize) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot size simulation image " + path);
+    }
+    mappedSize = created ? headerSize : status.st_size;
+    void *mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map simulation image " + path);
+    }
+    base = static_cast<char*>(mapped);
+    if (created) {
+        header().magic = imageMagic;
+        header().formatVersion = imageFormatVersion;
+        msync(base, headerSize, MS_SYNC);
+    } else if (mappedSize < headerSize || header().magic != imageMagic || header().formatVersion != imageFormatVersion) {
+        munmap(base, mappedSize);
+        ::close(fd);
+        throw std::runtime_error("Not a simulation image: " + path);
+    }
+    dropUncommitted();
+}
+
+SimulationImage::~SimulationImage() {
+    munmap(base, mappedSize);
+    ::close(fd);
+}
+
+ImageHeader &SimulationImage::header() const {
+    return *reinterpret_cast<ImageHeader*>(base);
+}
+
+// Newest root that was fully written, nullptr if there is none
+const ImageRoot *SimulationImage::committedRoot() const {
+    const ImageRoot *committed = nullptr;
+    for (const ImageRoot &root : header().roots) {
+        if (root.generation == 0 || root.arenaEnd > mappedSize || root.checksum != rootChecksum(root)) {
+            continue;
+        }
+        if (committed == nullptr || root.generation > committed->generation) {
+            committed = &root;
+        }
+    }
+    return committed;
+}
+
+// Copies written by a checkpoint that did not commit would count once the
+// next one reuses their generation, and their extents lie past the committed
+// arena where new records will be allocated, so they are forgotten on open
+void SimulationImage::dropUncommitted() {
+    const ImageRoot *root = committedRoot();
+    if (root == nullptr) {
+        return;
+    }
+    PlanSlot *slots = at<PlanSlot>(root->planTable);
+    for (uint32_t i = 0; i < root->planCount; i++) {
+        for (PlanRecord &copy : slots[i].copies) {
+            if (copy.generation > root->generation) {
+                std::memset(&copy, 0, sizeof(copy));
+            }
+        }
+    }
+}
+
+bool SimulationImage::hasCheckpoint() const {
+    return committedRoot() != nullptr;
+}
+
+uint64_t SimulationImage::getGeneration() const {
+    const ImageRoot *root = committedRoot();
+    return root == nullptr ? 0 : root->generation;
+}
+
+// Room for size bytes after everything the root uses. The mapping may move.
+uint64_t SimulationImage::allocate(ImageRoot &root, size_t size) {
+    uint64_t offset = TablesLayout::align(root.arenaEnd);
+    root.arenaEnd = offset + size;
+    reserve(root.arenaEnd);
+    return offset;
+}
+
+void SimulationImage::reserve(size_t size) {
+    if (size <= mappedSize) {
+        return;
+    }
+    size_t grown = std::max(pageAlign(size), mappedSize * 2);
+    if (ftruncate(fd, grown) != 0) {
+        throw std::runtime_error("Cannot grow simulation image");
+    }
+    void *mapped = mremap(base, mappedSize, grown, MREMAP_MAYMOVE);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map simulation image");
+    }
+    base = static_cast<char*>(mapped);
+    mappedSize = grown;
+}
+
+// Write the plans changed since the last checkpoint, and the tables if they grew, then commit
+void SimulationImage::checkpoint(Simulation &simulation) {
+    TRACE_SCOPE("SimulationImage::checkpoint");
+    shared_ptr<const FacilityCatalog::Snapshot> catalog = simulation.facilitiesOptions.pin();
+    const vector<FacilityType> &options = catalog->getOptions();
+
+    // Copies, since allocating may move the mapping
+    ImageRoot previous;
+    std::memset(&previous, 0, sizeof(previous));
+    const ImageRoot *committed = committedRoot();
+    int target = committed == &header().roots[0] ? 1 : 0;
+    if (committed != nullptr) {
+        std::memcpy(&previous, committed, sizeof(previous));
+    }
+    ImageRoot replaced;
+    std::memcpy(&replaced, &header().roots[target], sizeof(replaced));
+    ImageRoot root;
+    std::memcpy(&root, &previous, sizeof(root));
+    root.generation = previous.generation + 1;
+    root.arenaEnd = std::max<uint64_t>(previous.arenaEnd, headerSize);
+    root.tick = simulation.tickCounter;
+    root.stochastic = simulation.stochasticModel != nullptr;
+    root.stochasticSeed = simulation.stochasticSeed;
+    for (int i = 0; i < 3; i++) {
+        root.minimumDuration[i] = simulation.durationModel.getMinimum(static_cast<FacilityCategory>(i));
+        root.maximumDuration[i] = simulation.durationModel.getMaximum(static_cast<FacilityCategory>(i));
+    }
+
+    // Settlements and the catalog only grow, so the same counts mean the same tables
+    size_t settlementCount = simulation.settlements.size();
+    if (!inSync || root.settlementCount != static_cast<int32_t>(settlementCount) || root.facilityTypeCount != static_cast<int32_t>(options.size())) {
+        size_t nameBytes = 0;
+        for (const shared_ptr<Settlement> &settlement : simulation.settlements) {
+            nameBytes += settlement->getName().size();
+        }
+        for (const FacilityType &type : options) {
+            nameBytes += type.getName().size();
+        }
+        TablesLayout layout(settlementCount, options.size(), nameBytes);
+        // The replaced root's tables are free unless the committed root still uses them
+        bool reusable = replaced.generation != 0 && replaced.checksum == rootChecksum(replaced) && replaced.tables != previous.tables
+                        && replaced.tables + replaced.tablesCapacity <= root.arenaEnd;
+        if (reusable && replaced.tablesCapacity >= layout.size) {
+            root.tables = replaced.tables;
+            root.tablesCapacity = replaced.tablesCapacity;
+        } else {
+            root.tablesCapacity = layout.size * 2;
+            root.tables = allocate(root, root.tablesCapacity);
+        }
+        char *tables = at<char>(root.tables);
+        SettlementRecord *settlements = reinterpret_cast<SettlementRecord*>(tables);
+        FacilityTypeRecord *facilityTypes = reinterpret_cast<FacilityTypeRecord*>(tables + layout.facilityTypes);
+        char *names = tables + layout.names;
+        uint32_t nameOffset = 0;
+        for (size_t i = 0; i < settlementCount; i++) {
+            const Settlement &settlement = *simulation.settlements[i];
+            const string &name = settlement.getName();
+            settlements[i] = SettlementRecord{nameOffset, static_cast<uint32_t>(name.size()), static_cast<int32_t>(settlement.getType())};
+            std::memcpy(names + nameOffset, name.data(), name.size());
+            nameOffset += name.size();
+        }
+        for (size_t i = 0; i < options.size(); i++) {
+            const FacilityType &type = options[i];
+            facilityTypes[i] = FacilityTypeRecord{nameOffset, static_cast<uint32_t>(type.getName().size()), static_cast<int32_t>(type.getCategory()),
+                                                  type.getCost(), type.getLifeQualityScore(), type.getEconomyScore(), type.getEnvironmentScore()};
+            std::memcpy(names + nameOffset, type.getName().data(), type.getName().size());
+            nameOffset += type.getName().size();
+        }
+        root.settlementCount = settlementCount;
+        root.facilityTypeCount = options.size();
+    }
+    for (size_t i = settlementIndices.size(); i < settlementCount; i++) {
+        settlementIndices[simulation.settlements[i].get()] = i;
+    }
+
+    // The plan table moves only when it is full, keeping the records of unchanged plans
+    uint32_t planCount = simulation.plans.size();
+    if (previous.generation == 0 || previous.planCapacity < planCount) {
+        root.planCapacity = std::max<uint32_t>(64, planCount * 2);
+        root.planTable = allocate(root, root.planCapacity * sizeof(PlanSlot));
+        if (previous.generation != 0) {
+            std::memcpy(at<PlanSlot>(root.planTable), at<PlanSlot>(previous.planTable), previous.planCount * sizeof(PlanSlot));
+        }
+    }
+    if (planCount > previous.planCount) {
+        std::memset(at<PlanSlot>(root.planTable) + previous.planCount, 0, (planCount - previous.planCount) * sizeof(PlanSlot));
+    }
+    root.planCount = planCount;
+
+    // Changed plans go to the copy the committed root does not use. Spilled
+    // runs are copied from the cold store without faulting the plan in.
+    vector<OperationalFacilities, TrackingAllocator<OperationalFacilities, MemorySubsystem::PLAN>> spilled;
+    for (uint32_t i = 0; i < planCount; i++) {
+        if (!simulation.changedPlans[i]) {
+            continue;
+        }
+        const Plan &plan = *simulation.plans[i];
+        if (plan.underConstruction.size() > maxConstructions) {
+            throw std::runtime_error("Too many facilities under construction for the simulation image");
+        }
+        spilled.clear();
+        if (plan.isSpilled()) {
+            plan.coldStore->read(plan.coldSegment, spilled);
+        }
+        uint32_t runCount = spilled.size() + plan.operational->size();
+        uint64_t slot = root.planTable + i * sizeof(PlanSlot);
+        int copy = currentCopy(*at<PlanSlot>(slot), previous.generation) == 1 ? 0 : 1;
+        // An extent past the committed arena was handed out by a checkpoint that did not commit,
+        // allocate() may give those bytes to something else
+        const PlanRecord &written = at<PlanSlot>(slot)->copies[copy];
+        if (written.runCapacity < runCount || written.runs + written.runCapacity * sizeof(RunRecord) > previous.arenaEnd) {
+            uint32_t capacity = std::max<uint32_t>(4, runCount * 2);
+            uint64_t runs = allocate(root, capacity * sizeof(RunRecord));
+            at<PlanSlot>(slot)->copies[copy].runs = runs;
+            at<PlanSlot>(slot)->copies[copy].runCapacity = capacity;
+        }
+        PlanRecord &record = at<PlanSlot>(slot)->copies[copy];
+        record.generation = root.generation;
+        record.settlement = settlementIndices.at(&plan.settlement);
+        record.status = static_cast<int32_t>(plan.status);
+        record.lifeQualityScore = plan.life_quality_score;
+        record.economyScore = plan.economy_score;
+        record.environmentScore = plan.environment_score;
+        record.constructionCount = plan.underConstruction.size();
+        for (size_t c = 0; c < maxConstructions; c++) {
+            record.constructions[c] = c < plan.underConstruction.size()
+                ? ConstructionRecord{plan.underConstruction[c].typeIndex, plan.underConstruction[c].facility->getTimeLeft()}
+                : ConstructionRecord{0, 0};
+        }
+        record.policy = plan.selectionPolicy->saveState();
+        record.random = plan.random.getState();
+        RunRecord *runs = at<RunRecord>(record.runs);
+        uint32_t r = 0;
+        for (const OperationalFacilities &run : spilled) {
+            runs[r++] = RunRecord{run.typeIndex, run.count};
+        }
+        for (const OperationalFacilities &run : *plan.operational) {
+            runs[r++] = RunRecord{run.typeIndex, run.count};
+        }
+        record.runCount = runCount;
+    }
+
+    // Flush the records, then commit them through the header. Only dirty pages are written back.
+    msync(base + headerSize, pageAlign(root.arenaEnd) - headerSize, MS_SYNC);
+    root.checksum = rootChecksum(root);
+    std::memcpy(&header().roots[target], &root, sizeof(root));
+    msync(base, headerSize, MS_SYNC);
+    simulation.changedPlans.assign(planCount, false);
+    inSync = true;
+}
+
+// Rebuild the state of the last committed checkpoint into an empty simulation.
+// Later checkpoints into this image only write what changes after it.
+void SimulationImage::restore(Simulation &simulation) {
+    TRACE_SCOPE("SimulationImage::restore");
+    const ImageRoot *committed = committedRoot();
+    if (committed == nullptr) {
+        throw std::runtime_error("Simulation image has no checkpoint");
+    }
+    ImageRoot root;
+    std::memcpy(&root, committed, sizeof(root));
+    const char *tables = at<char>(root.tables);
+    TablesLayout layout(root.settlementCount, root.facilityTypeCount, 0);
+    const SettlementRecord *settlements = reinterpret_cast<const SettlementRecord*>(tables);
+    const FacilityTypeRecord *facilityTypes = reinterpret_cast<const FacilityTypeRecord*>(tables + layout.facilityTypes);
+    const char *names = tables + layout.names;
+
+    for (int i = 0; i < root.settlementCount; i++) {
+        const SettlementRecord &record = settlements[i];
+        simulation.addSettlement(new Settlement(string(names + record.name, record.nameLength), static_cast<SettlementType>(record.type)));
+    }
+    vector<FacilityType> facilities;
+    facilities.reserve(root.facilityTypeCount);
+    for (int i = 0; i < root.facilityTypeCount; i++) {
+        const FacilityTypeRecord &record = facilityTypes[i];
+        facilities.push_back(FacilityType(string(names + record.name, record.nameLength), static_cast<FacilityCategory>(record.category),
+                                          record.price, record.lifeQualityScore, record.economyScore, record.environmentScore));
+    }
+    simulation.addFacilities(facilities);
+    for (int i = 0; i < 3; i++) {
+        simulation.durationModel.setDuration(static_cast<FacilityCategory>(i), root.minimumDuration[i], root.maximumDuration[i]);
+    }
+    shared_ptr<const FacilityCatalog::Snapshot> catalog = simulation.facilitiesOptions.pin();
+    const vector<FacilityType> &options = catalog->getOptions();
+    const PlanSlot *slots = at<PlanSlot>(root.planTable);
+    for (uint32_t i = 0; i < root.planCount; i++) {
+        int copy = currentCopy(slots[i], root.generation);
+        if (copy < 0) {
+            throw std::runtime_error("Simulation image misses a plan");
+        }
+        const PlanRecord &record = slots[i].copies[copy];
+        simulation.addPlan(simulation.settlements.at(record.settlement).get(), SelectionPolicy::restoreState(record.policy));
+        Plan &plan = *simulation.plans.back();
+        plan.selectionPolicy->reseed(record.policy.random); //addPlan seeded it afresh
+        plan.status = static_cast<PlanStatus>(record.status);
+        plan.life_quality_score = record.lifeQualityScore;
+        plan.economy_score = record.economyScore;
+        plan.environment_score = record.environmentScore;
+        plan.random = RandomStream(record.random);
+        for (int c = 0; c < record.constructionCount; c++) {
+            const ConstructionRecord &construction = record.constructions[c];
+            Facility *facility = new Facility(options.at(construction.facilityType), plan.settlement.getName(),
+                                              FacilityStatus::UNDER_CONSTRUCTIONS, construction.timeLeft);
+            plan.underConstruction.push_back(FacilityUnderConstruction{facility, construction.facilityType});
+        }
+        const RunRecord *runs = at<RunRecord>(record.runs);
+        for (uint32_t r = 0; r < record.runCount; r++) {
+            bool merged = false;
+            for (OperationalFacilities &run : *plan.operational) {
+                if (run.typeIndex == runs[r].facilityType) {
+                    run.count += runs[r].count;
+                    merged = true;
+                    break;
+                }
+            }
+            if (!merged) {
+                plan.operational->push_back(OperationalFacilities(runs[r].facilityType, runs[r].count));
+            }
+        }
+    }
+    // Set after the plans are added, which would otherwise reseed them
+    if (root.stochastic) {
+        simulation.stochasticModel = std::make_shared<const StochasticModel>(simulation.durationModel);
+        simulation.stochasticSeed = root.stochasticSeed;
+        for (const shared_ptr<Plan> &plan : simulation.plans) {
+            plan->stochastic = simulation.stochasticModel;
+        }
+    }
+    simulation.tickCounter = root.tick;
+    simulation.changedPlans.assign(root.planCount, false);
+    inSync = true;
+}
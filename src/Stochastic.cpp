@@ -0,0 +1,68 @@
+#include "Stochastic.h"
+#include <sstream>
+#include <stdexcept>
+
+// ================== RandomStream ==================
+RandomStream::RandomStream(uint64_t seed) : state(seed) {}
+
+uint64_t RandomStream::next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t RandomStream::getState() const {
+    return state;
+}
+
+int RandomStream::nextInt(int minimum, int maximum) {
+    if (maximum <= minimum) {
+        return minimum;
+    }
+    uint64_t range = static_cast<uint64_t>(maximum - minimum) + 1;
+    return minimum + static_cast<int>(next() % range);
+}
+
+uint64_t RandomStream::mix(uint64_t seed, uint64_t stream) {
+    RandomStream random(seed ^ (stream * 0xd1342543de82ef95ULL));
+    return random.next();
+}
+
+// ================== StochasticModel ==================
+StochasticModel::StochasticModel() {
+    for (int i = 0; i < categoryCount; i++) {
+        minimumDuration[i] = 10;
+        maximumDuration[i] = 10;
+    }
+}
+
+void StochasticModel::setDuration(FacilityCategory category, int minimum, int maximum) {
+    int index = static_cast<int>(category);
+    if (index < 0 || index >= categoryCount || minimum < 1 || maximum < minimum) {
+        throw std::runtime_error("Invalid construction duration");
+    }
+    minimumDuration[index] = minimum;
+    maximumDuration[index] = maximum;
+}
+
+int StochasticModel::drawDuration(FacilityCategory category, RandomStream &random) const {
+    int index = static_cast<int>(category);
+    return random.nextInt(minimumDuration[index], maximumDuration[index]);
+}
+
+int StochasticModel::getMinimum(FacilityCategory category) const {
+    return minimumDuration[static_cast<int>(category)];
+}
+
+int StochasticModel::getMaximum(FacilityCategory category) const {
+    return maximumDuration[static_cast<int>(category)];
+}
+
+const string StochasticModel::toString() const {
+    std::stringstream ss;
+    for (int i = 0; i < categoryCount; i++) {
+        ss << (i > 0 ? ", " : "") << minimumDuration[i] << "-" << maximumDuration[i];
+    }
+    return ss.str();
+}
@@ -0,0 +1,127 @@
+#include "Trace.h"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+using std::vector;
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    long long start;
+    long long end;
+};
+
+// Single writer (the owning thread), read by the exporter
+struct TraceBuffer {
+    static const unsigned long capacity = 1 << 16;
+    TraceBuffer(int threadId) : threadId(threadId), written(0) {}
+    const int threadId;
+    std::atomic<unsigned long> written;
+    TraceEvent events[capacity];
+};
+
+std::mutex buffersMutex; //Guards registration and export, never taken on the recording path
+vector<std::unique_ptr<TraceBuffer>> buffers;
+vector<TraceBuffer*> freeBuffers; //Rings of threads that exited, handed to the next thread that records
+
+// A ring is only ever added for a thread that records while every existing
+// ring is in use, so memory is bounded by the most threads recording at once.
+// A reused ring keeps its events and its tid until they are overwritten.
+TraceBuffer *registerThread() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    if (!freeBuffers.empty()) {
+        TraceBuffer *buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+        return buffer;
+    }
+    buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer(buffers.size() + 1)));
+    return buffers.back().get();
+}
+
+// Returns the thread's ring to the free list when the thread exits
+struct ThreadBuffer {
+    TraceBuffer *buffer = nullptr;
+    ~ThreadBuffer() {
+        if (buffer != nullptr) {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            freeBuffers.push_back(buffer);
+        }
+    }
+};
+
+thread_local ThreadBuffer threadBuffer;
+thread_local int sampleCounter = 0;
+
+}
+
+std::atomic<bool> Trace::enabled(false);
+
+void Trace::enable() {
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::disable() {
+    enabled.store(false, std::memory_order_relaxed);
+}
+
+long long Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::record(const char *name, long long start, long long end) {
+    if (threadBuffer.buffer == nullptr) {
+        threadBuffer.buffer = registerThread();
+    }
+    TraceBuffer *buffer = threadBuffer.buffer;
+    unsigned long index = buffer->written.load(std::memory_order_relaxed);
+    buffer->events[index % TraceBuffer::capacity] = TraceEvent{name, start, end};
+    buffer->written.store(index + 1, std::memory_order_release);
+}
+
+bool Trace::shouldSample(int sampleEvery) {
+    if (++sampleCounter < sampleEvery) {
+        return false;
+    }
+    sampleCounter = 0;
+    return true;
+}
+
+// Writes the events still held by the rings, oldest first per thread.
+// Slots a thread overwrote while we were copying them are dropped.
+bool Trace::writeChromeTrace(const string &path) {
+    std::ofstream output(path);
+    if (!output) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    output << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    bool first = true;
+    for (const std::unique_ptr<TraceBuffer> &buffer : buffers) {
+        unsigned long end = buffer->written.load(std::memory_order_acquire);
+        unsigned long begin = end > TraceBuffer::capacity ? end - TraceBuffer::capacity : 0;
+        vector<TraceEvent> events;
+        events.reserve(end - begin);
+        for (unsigned long i = begin; i < end; i++) {
+            events.push_back(buffer->events[i % TraceBuffer::capacity]);
+        }
+        unsigned long after = buffer->written.load(std::memory_order_acquire);
+        unsigned long overwritten = after > TraceBuffer::capacity ? after - TraceBuffer::capacity : 0;
+        for (unsigned long i = begin; i < end; i++) {
+            if (i < overwritten) {
+                continue;
+            }
+            const TraceEvent &event = events[i - begin];
+            output << (first ? "" : ",") << "\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1"
+                   << ",\"tid\":" << buffer->threadId
+                   << ",\"ts\":" << event.start / 1000.0
+                   << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+            first = false;
+        }
+    }
+    output << "\n]}\n";
+    return bool(output);
+}
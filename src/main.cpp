@@ -1,13 +1,139 @@
 #include "Simulation.h"
+#include "CommandServer.h"
+#include "ShardCoordinator.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include "ScoreRecorder.h"
 #include <iostream>
+#include <string>
+#include <memory>
+#include <stdexcept>
 
 using namespace std;
 
 // Simulation* backup = nullptr;
 
+// "--embedded" in place of the config path starts from the config compiled in by the build
+Simulation *loadSimulation(const string &configPath){
+    if(configPath=="--embedded"){
+        return new Simulation(EmbeddedConfig());
+    }
+    return new Simulation(configPath);
+}
+
 int main(int argc, char** argv){
-    if(argc!=2){
-        cout << "usage: simulation <config_path>" << endl;
+    if(argc==4 && string(argv[1])=="--scores-to-csv"){
+        if(!ScoreRecorder::convertToCsv(argv[2], argv[3])){
+            cout << "Cannot convert " << argv[2] << endl;
+            return 1;
+        }
+        return 0;
+    }
+    if(argc<2){
+        cout << "usage: simulation <config_path | --embedded> [--socket <socket_path> | --shards <count>] [--record <scores_path>] [--cold-store <segment_path> [--cold-after <ticks>]] [--image <image_path> [--image-every <ticks>]] [--shared-capacity] [--perf-counters] [--trace <trace_path>]" << endl;
+        return 0;
+    }
+    string socketPath;
+    string tracePath;
+    string recordPath;
+    string coldStorePath;
+    string imagePath;
+    int imageEveryTicks = 1000;
+    bool sharedCapacity = false;
+    int coldAfterTicks = 1000;
+    int shardCount = 0;
+    for(int i = 2; i < argc; i++){
+        string option = argv[i];
+        if(option=="--socket" && i+1<argc){
+            socketPath = argv[++i];
+        }
+        else if(option=="--shards" && i+1<argc){
+            shardCount = stoi(argv[++i]);
+        }
+        else if(option=="--record" && i+1<argc){
+            recordPath = argv[++i];
+        }
+        else if(option=="--cold-store" && i+1<argc){
+            coldStorePath = argv[++i];
+        }
+        else if(option=="--cold-after" && i+1<argc){
+            coldAfterTicks = stoi(argv[++i]);
+        }
+        else if(option=="--image" && i+1<argc){
+            imagePath = argv[++i];
+        }
+        else if(option=="--image-every" && i+1<argc){
+            imageEveryTicks = stoi(argv[++i]);
+        }
+        else if(option=="--shared-capacity"){
+            sharedCapacity = true;
+        }
+        else if(option=="--perf-counters"){
+            PerfCounters::enable();
+        }
+        else if(option=="--trace" && i+1<argc){
+            tracePath = argv[++i];
+            Trace::enable();
+        }
+        else{
+            cout << "usage: simulation <config_path | --embedded> [--socket <socket_path> | --shards <count>] [--record <scores_path>] [--cold-store <segment_path> [--cold-after <ticks>]] [--image <image_path> [--image-every <ticks>]] [--shared-capacity] [--perf-counters] [--trace <trace_path>]" << endl;
+            return 0;
+        }
+    }
+    if(shardCount>0){
+        // Coordinator mode: console commands from stdin, plans stepped by worker processes
+        if(!imagePath.empty()){
+            cout << "--image cannot be combined with --shards" << endl;
+            return 1;
+        }
+        unique_ptr<Simulation> simulation(loadSimulation(argv[1]));
+        if(sharedCapacity){
+            simulation->enableSharedCapacity();
+        }
+        simulation->start();
+        ShardCoordinator coordinator(*simulation, shardCount, ShardFiles{recordPath, coldStorePath, coldAfterTicks});
+        string line;
+        while(getline(cin, line)){
+            try{
+                cout << coordinator.execute(line) << flush;
+            }
+            catch(const std::runtime_error &e){
+                cout << "Error: " << e.what() << "\nERROR" << endl;
+            }
+            if(line=="close"){
+                break;
+            }
+        }
+        return 0;
+    }
+    if(!socketPath.empty()){
+        // A warm restart: with an image that has a checkpoint the config is not read
+        unique_ptr<Simulation> simulation;
+        if(!imagePath.empty()){
+            simulation = Simulation::openImage(imagePath, imageEveryTicks);
+        }
+        if(simulation==nullptr){
+            simulation.reset(loadSimulation(argv[1]));
+            if(!imagePath.empty()){
+                simulation->attachImage(imagePath, imageEveryTicks);
+            }
+        }
+        if(sharedCapacity){
+            simulation->enableSharedCapacity();
+        }
+        simulation->start();
+        if(!recordPath.empty()){
+            simulation->startRecording(recordPath);
+        }
+        if(!coldStorePath.empty()){
+            simulation->enableColdStore(coldStorePath, coldAfterTicks);
+        }
+        CommandServer server(*simulation, socketPath);
+        server.run();
+        simulation->checkpoint();
+        if(!tracePath.empty()){
+            Trace::writeChromeTrace(tracePath);
+        }
         return 0;
     }
     //  string configurationFile = argv[1];